@@ -0,0 +1,94 @@
+#include "../include/parseobj.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Writes a grid x grid height field, two textured triangles per cell, in
+// the same "f v/vt/vn" form the Kenney exports use
+static void writeSyntheticObj(const std::string& path, int grid)
+{
+    std::FILE* file {std::fopen(path.c_str(), "wb")};
+    if (file == nullptr)
+    {
+        throw std::runtime_error("could not create " + path);
+    }
+
+    std::vector<char> buffer(1 << 20);
+    std::setvbuf(file, buffer.data(), _IOFBF, buffer.size());
+
+    std::fprintf(file, "# Synthetic benchmark mesh\n");
+
+    for (int y = 0; y <= grid; ++y)
+    {
+        for (int x = 0; x <= grid; ++x)
+        {
+            float h {0.05f * (float)((x * 7 + y * 13) % 17)};
+            std::fprintf(file, "v %.6f %.6f %.6f\n", x / (float)grid, h, y / (float)grid);
+        }
+    }
+
+    for (int y = 0; y < grid; ++y)
+    {
+        for (int x = 0; x < grid; ++x)
+        {
+            int a {y * (grid + 1) + x + 1};
+            int b {a + 1};
+            int c {a + grid + 1};
+            int d {c + 1};
+
+            std::fprintf(file, "f %d/%d/1 %d/%d/1 %d/%d/1\n", a, a, b, b, d, d);
+            std::fprintf(file, "f %d/%d/1 %d/%d/1 %d/%d/1\n", a, a, d, d, c, c);
+        }
+    }
+
+    std::fclose(file);
+}
+
+int main(int argc, char** argv)
+{
+    int grid {argc > 1 ? std::stoi(argv[1]) : 1024};
+    int runs {argc > 2 ? std::stoi(argv[2]) : 5};
+
+    std::string path {(std::filesystem::temp_directory_path() / "rast_objload_bench.obj").string()};
+
+    std::cout << "Generating " << grid << "x" << grid << " grid..." << std::endl;
+    writeSyntheticObj(path, grid);
+
+    double megabytes {std::filesystem::file_size(path) / (1024.0 * 1024.0)};
+
+    for (ObjParseMode mode : {ObjParseMode::Serial, ObjParseMode::Parallel})
+    {
+        std::vector<double> seconds;
+
+        for (int run = 0; run < runs; ++run)
+        {
+            auto start {std::chrono::steady_clock::now()};
+            Mesh mesh {getMeshFromObj(path, mode)};
+            auto stop {std::chrono::steady_clock::now()};
+
+            seconds.push_back(std::chrono::duration<double>(stop - start).count());
+
+            if (run == 0 && mode == ObjParseMode::Serial)
+            {
+                std::cout << mesh.vertices.size() << " vertices, "
+                          << getMeshLength(mesh) << " triangles, "
+                          << megabytes << " MB" << std::endl;
+            }
+        }
+
+        std::sort(seconds.begin(), seconds.end());
+
+        const char* name {mode == ObjParseMode::Serial ? "serial  " : "parallel"};
+        std::cout << name << " best   " << seconds.front() * 1000.0 << " ms, "
+                  << megabytes / seconds.front() << " MB/s" << std::endl;
+        std::cout << name << " median " << seconds[seconds.size() / 2] * 1000.0 << " ms, "
+                  << megabytes / seconds[seconds.size() / 2] << " MB/s" << std::endl;
+    }
+
+    std::filesystem::remove(path);
+}
@@ -0,0 +1,527 @@
+#include "../include/renderer.hpp"
+#include "../include/scene.hpp"
+#include "../include/camerapath.hpp"
+#include "../include/parseobj.hpp"
+#include "../include/meshopt.hpp"
+#include "../include/texture.hpp"
+#include "../include/lod.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <span>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef _MSC_VER
+#include <malloc.h>
+#endif
+
+// Allocation counter hook: every global operator new in the process goes
+// through here, so frames can be checked for heap traffic. All forms are
+// replaced, nothrow and array ones included, so every block is counted and
+// freed by the allocator that made it.
+static std::atomic<uint64_t> g_allocations {0};
+
+static void* allocate(size_t size)
+{
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    return std::malloc(size == 0 ? 1 : size);
+}
+
+static void* allocateAligned(size_t size, std::align_val_t align)
+{
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+
+    size_t a {(size_t)align};
+#ifdef _MSC_VER
+    // The CRT has no aligned_alloc; its aligned blocks need _aligned_free
+    return _aligned_malloc(size == 0 ? 1 : size, a);
+#else
+    // aligned_alloc wants a nonzero multiple of the alignment
+    return std::aligned_alloc(a, size == 0 ? a : (size + a - 1) / a * a);
+#endif
+}
+
+static void freeAligned(void* p)
+{
+#ifdef _MSC_VER
+    _aligned_free(p);
+#else
+    std::free(p);
+#endif
+}
+
+void* operator new(size_t size)
+{
+    if (void* p {allocate(size)}) return p;
+    throw std::bad_alloc();
+}
+
+void* operator new(size_t size, std::align_val_t align)
+{
+    if (void* p {allocateAligned(size, align)}) return p;
+    throw std::bad_alloc();
+}
+
+void* operator new[](size_t size) {return operator new(size);}
+void* operator new[](size_t size, std::align_val_t align) {return operator new(size, align);}
+void* operator new(size_t size, const std::nothrow_t&) noexcept {return allocate(size);}
+void* operator new[](size_t size, const std::nothrow_t&) noexcept {return allocate(size);}
+void* operator new(size_t size, std::align_val_t align, const std::nothrow_t&) noexcept {return allocateAligned(size, align);}
+void* operator new[](size_t size, std::align_val_t align, const std::nothrow_t&) noexcept {return allocateAligned(size, align);}
+
+void operator delete(void* p) noexcept {std::free(p);}
+void operator delete(void* p, size_t) noexcept {std::free(p);}
+void operator delete(void* p, const std::nothrow_t&) noexcept {std::free(p);}
+void operator delete[](void* p) noexcept {std::free(p);}
+void operator delete[](void* p, size_t) noexcept {std::free(p);}
+void operator delete[](void* p, const std::nothrow_t&) noexcept {std::free(p);}
+void operator delete(void* p, std::align_val_t) noexcept {freeAligned(p);}
+void operator delete(void* p, size_t, std::align_val_t) noexcept {freeAligned(p);}
+void operator delete(void* p, std::align_val_t, const std::nothrow_t&) noexcept {freeAligned(p);}
+void operator delete[](void* p, std::align_val_t) noexcept {freeAligned(p);}
+void operator delete[](void* p, size_t, std::align_val_t) noexcept {freeAligned(p);}
+void operator delete[](void* p, std::align_val_t, const std::nothrow_t&) noexcept {freeAligned(p);}
+
+struct BenchOptions
+{
+    int width {RAST::SCREEN_WIDTH};
+    int height {RAST::SCREEN_HEIGHT};
+    int frames {240};
+    int warmup {10};
+    std::string obj {"blaster-a.obj"};
+    std::string out;
+};
+
+struct BenchScene
+{
+    std::string name;
+    MeshView mesh;
+    std::vector<Transform> placements;
+    // Orbit distance relative to the scene bounds; below 1 flies inside them
+    float orbit_scale {1.0f};
+    // When set, each placement is drawn with RenderObject on this copy of
+    // mesh instead of going through the scene
+    MeshSoA* soa {nullptr};
+    // Draws every placement of mesh in one RenderInstanced call instead
+    bool instanced {false};
+};
+
+struct BenchResult
+{
+    std::string name;
+    size_t objects;
+    size_t source_triangles;
+    std::vector<double> frame_ms;
+    std::vector<uint64_t> frame_allocations;
+    RenderStats totals;
+
+    // Job system activity summed over the measured frames
+    double job_frame_ms;
+    std::vector<WorkerReport> workers;
+};
+
+static Transform placement(Vector3 pos, float scale)
+{
+    return Transform(pos, Vector3(scale, scale, scale), Quaternion(1, 0, 0, 0));
+}
+
+// Rolling height field, 2 * cells_x * cells_z triangles
+static Mesh makeGrid(int cells_x, int cells_z)
+{
+    Mesh m;
+    m.vertices.reserve((size_t)(cells_x + 1) * (cells_z + 1));
+    m.indices.reserve((size_t)cells_x * cells_z * 6);
+
+    for (int z = 0; z <= cells_z; ++z)
+    {
+        for (int x = 0; x <= cells_x; ++x)
+        {
+            float u {x / (float)cells_x};
+            float v {z / (float)cells_z};
+            float h {0.05f * std::sin(u * 40.0f) * std::cos(v * 23.0f)};
+            m.vertices.push_back(Vertex{
+                Vector3(u * 2.0f - 1.0f, h, v * 2.0f - 1.0f),
+                ColorRGB(u, 0.5f + h * 5.0f, v),
+                Vector2(u * 16.0f, v * 8.0f)
+            });
+        }
+    }
+
+    for (int z = 0; z < cells_z; ++z)
+    {
+        for (int x = 0; x < cells_x; ++x)
+        {
+            uint32_t a {(uint32_t)(z * (cells_x + 1) + x)};
+            uint32_t b {a + 1};
+            uint32_t c {a + (uint32_t)cells_x + 1};
+            uint32_t d {c + 1};
+            m.indices.insert(m.indices.end(), {a, c, b, b, c, d});
+        }
+    }
+
+    m.bounds = computeBounds(m.vertices.data(), m.vertices.size());
+    return m;
+}
+
+// Unit UV sphere, 2 * rings * segments triangles including the pole slivers
+static Mesh makeSphere(int rings, int segments)
+{
+    Mesh m;
+    m.vertices.reserve((size_t)(rings + 1) * (segments + 1));
+    m.indices.reserve((size_t)rings * segments * 6);
+
+    for (int r = 0; r <= rings; ++r)
+    {
+        float theta {PI * r / (float)rings};
+        for (int s = 0; s <= segments; ++s)
+        {
+            float phi {2.0f * PI * s / (float)segments};
+            Vector3 p {std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi)};
+            m.vertices.push_back(Vertex{p, ColorRGB(0.5f + 0.5f * p.x(), 0.5f + 0.5f * p.y(), 0.5f + 0.5f * p.z())});
+        }
+    }
+
+    for (int r = 0; r < rings; ++r)
+    {
+        for (int s = 0; s < segments; ++s)
+        {
+            uint32_t a {(uint32_t)(r * (segments + 1) + s)};
+            uint32_t b {a + 1};
+            uint32_t c {a + (uint32_t)segments + 1};
+            uint32_t d {c + 1};
+            m.indices.insert(m.indices.end(), {a, c, b, b, c, d});
+        }
+    }
+
+    m.bounds = computeBounds(m.vertices.data(), m.vertices.size());
+    return m;
+}
+
+// Two-tone checkerboard with 8x8-texel squares
+static Texture makeChecker(int size)
+{
+    std::vector<uint32_t> texels((size_t)size * size);
+    for (int y = 0; y < size; ++y)
+    {
+        for (int x = 0; x < size; ++x)
+        {
+            texels[(size_t)y * size + x] = ((x ^ y) & 8) ? 0xFFE0E0E0u : 0xFF303848u;
+        }
+    }
+    return Texture(size, size, texels);
+}
+
+// One orbit around the scene bounds, bobbing vertically, always facing the center
+static CameraPath orbitPath(const AABB& box, float orbit_scale, int frames)
+{
+    Vector3 box_min {box.min};
+    Vector3 box_max {box.max};
+    Vector3 center {(box_min + box_max) * 0.5f};
+    float radius {(box_max - box_min).magnitude() * 0.5f * orbit_scale};
+
+    std::vector<CameraKey> keys;
+    for (int frame = 0; frame < frames; ++frame)
+    {
+        float t {frame / (float)frames};
+        float angle {2.0f * PI * t};
+        float distance {radius * (1.6f + 0.4f * std::cos(2.0f * angle))};
+
+        Vector3 offset {std::sin(angle) * distance, radius * 0.5f * std::sin(angle), -std::cos(angle) * distance};
+        Vector3 eye {center + offset};
+        Vector3 dir {(-offset).unit()};
+
+        float yaw {std::atan2(dir.x(), dir.z()) * 180.0f / PI};
+        float pitch {std::asin(-dir.y()) * 180.0f / PI};
+        keys.push_back(CameraKey{frame, eye, yaw, pitch});
+    }
+
+    return CameraPath(std::move(keys));
+}
+
+static double percentile(const std::vector<double>& sorted, double p)
+{
+    size_t rank {(size_t)std::ceil(p / 100.0 * sorted.size())};
+    return sorted[std::clamp(rank, (size_t)1, sorted.size()) - 1];
+}
+
+static BenchResult runScene(const BenchScene& bench, const BenchOptions& options)
+{
+    Scene scene;
+    AABB box {};
+    for (size_t i = 0; i < bench.placements.size(); ++i)
+    {
+        ObjectId id {scene.add(&bench.mesh, bench.placements[i])};
+        box = i == 0 ? scene.object(id).world_box : mergeAABB(box, scene.object(id).world_box);
+    }
+
+    Camera camera (
+        Vector3(0,0,0),
+        80.0f,
+        options.width/(float)options.height
+    );
+
+    CameraPath path {orbitPath(box, bench.orbit_scale, options.frames)};
+    Renderer renderer(options.width, options.height, &camera);
+
+    BenchResult result {bench.name, scene.size(), scene.size() * (bench.mesh.index_count / 3), {}, {}, {}, 0.0, {}};
+    result.frame_ms.reserve(options.frames);
+    result.frame_allocations.reserve(options.frames);
+
+    for (int frame = -options.warmup; frame < options.frames; ++frame)
+    {
+        path.apply(std::max(frame, 0), camera);
+        renderer.resetStats();
+
+        uint64_t allocations {g_allocations.load()};
+        auto start {std::chrono::steady_clock::now()};
+        renderer.BeginFrame();
+        if (bench.soa != nullptr)
+        {
+            for (const Transform& t : bench.placements)
+            {
+                renderer.RenderObject(RenderableSoA{bench.soa, t});
+            }
+        }
+        else if (bench.instanced)
+        {
+            renderer.RenderInstanced(bench.mesh, std::span<const Transform>(bench.placements));
+        }
+        else
+        {
+            renderer.RenderScene(scene);
+        }
+        renderer.EndFrame();
+        auto stop {std::chrono::steady_clock::now()};
+        allocations = g_allocations.load() - allocations;
+
+        if (frame < 0) continue;
+
+        result.frame_ms.push_back(std::chrono::duration<double, std::milli>(stop - start).count());
+        result.frame_allocations.push_back(allocations);
+
+        const RenderStats& stats {renderer.stats()};
+        RenderStats& totals {result.totals};
+        totals.vertices_transformed += stats.vertices_transformed;
+        totals.indices_processed += stats.indices_processed;
+        totals.triangles_submitted += stats.triangles_submitted;
+        totals.objects_culled += stats.objects_culled;
+        totals.triangles_lod_skipped += stats.triangles_lod_skipped;
+        totals.cull_ms += stats.cull_ms;
+        totals.vertex_ms += stats.vertex_ms;
+        totals.setup_ms += stats.setup_ms;
+        totals.bin_ms += stats.bin_ms;
+        totals.raster_ms += stats.raster_ms;
+        totals.present_ms += stats.present_ms;
+
+        const JobReport& jobs {renderer.jobReport()};
+        result.workers.resize(jobs.workers.size());
+        result.job_frame_ms += jobs.frame_ms;
+        for (size_t i = 0; i < jobs.workers.size(); ++i)
+        {
+            result.workers[i].busy_ms += jobs.workers[i].busy_ms;
+            result.workers[i].jobs += jobs.workers[i].jobs;
+            result.workers[i].steals += jobs.workers[i].steals;
+        }
+    }
+
+    return result;
+}
+
+static void writeResult(std::FILE* out, const BenchResult& r, bool last)
+{
+    std::vector<double> sorted {r.frame_ms};
+    std::sort(sorted.begin(), sorted.end());
+
+    double total_ms {0.0};
+    for (double ms : sorted) total_ms += ms;
+
+    uint64_t total_allocations {0};
+    uint64_t max_allocations {0};
+    for (uint64_t count : r.frame_allocations)
+    {
+        total_allocations += count;
+        max_allocations = std::max(max_allocations, count);
+    }
+
+    double frames {(double)sorted.size()};
+    double seconds {total_ms / 1000.0};
+    const RenderStats& t {r.totals};
+
+    std::fprintf(out, "    {\n");
+    std::fprintf(out, "      \"name\": \"%s\",\n", r.name.c_str());
+    std::fprintf(out, "      \"objects\": %zu,\n", r.objects);
+    std::fprintf(out, "      \"source_triangles\": %zu,\n", r.source_triangles);
+    std::fprintf(out, "      \"frame_ms\": {\"mean\": %.4f, \"min\": %.4f, \"p50\": %.4f, \"p90\": %.4f, \"p99\": %.4f, \"max\": %.4f},\n",
+        total_ms / frames, sorted.front(), percentile(sorted, 50.0), percentile(sorted, 90.0), percentile(sorted, 99.0), sorted.back());
+    std::fprintf(out, "      \"triangles_per_second\": %.0f,\n", t.indices_processed / 3 / seconds);
+    std::fprintf(out, "      \"submitted_triangles_per_second\": %.0f,\n", t.triangles_submitted / seconds);
+    std::fprintf(out, "      \"submitted_triangles_per_frame\": %.0f,\n", t.triangles_submitted / frames);
+    std::fprintf(out, "      \"objects_culled_per_frame\": %.2f,\n", t.objects_culled / frames);
+    // Triangles the visible objects' source meshes have, per triangle drawn after LOD selection
+    std::fprintf(out, "      \"lod_triangles_skipped_per_frame\": %.0f,\n", t.triangles_lod_skipped / frames);
+    std::fprintf(out, "      \"lod_triangle_reduction\": %.2f,\n",
+        t.indices_processed ? (t.indices_processed / 3 + t.triangles_lod_skipped) / (double)(t.indices_processed / 3) : 1.0);
+    std::fprintf(out, "      \"vertex_cache_ratio\": %.4f,\n", t.transformRatio());
+    std::fprintf(out, "      \"heap_allocations_per_frame\": {\"mean\": %.2f, \"max\": %llu},\n",
+        total_allocations / frames, (unsigned long long)max_allocations);
+    std::fprintf(out, "      \"stage_ms\": {\"cull\": %.4f, \"vertex\": %.4f, \"setup\": %.4f, \"bin\": %.4f, \"raster\": %.4f, \"present\": %.4f},\n",
+        t.cull_ms / frames, t.vertex_ms / frames, t.setup_ms / frames, t.bin_ms / frames, t.raster_ms / frames, t.present_ms / frames);
+
+    // Per job thread, averaged per frame; worker 0 is the rendering thread
+    std::fprintf(out, "      \"workers\": [");
+    for (size_t i = 0; i < r.workers.size(); ++i)
+    {
+        const WorkerReport& w {r.workers[i]};
+        std::fprintf(out, "%s\n        {\"busy_ms\": %.4f, \"idle_ms\": %.4f, \"utilization\": %.4f, \"jobs\": %.1f, \"steals\": %.1f}",
+            i == 0 ? "" : ",", w.busy_ms / frames, (r.job_frame_ms - w.busy_ms) / frames,
+            r.job_frame_ms > 0.0 ? w.busy_ms / r.job_frame_ms : 0.0, w.jobs / frames, w.steals / frames);
+    }
+    std::fprintf(out, "\n      ]\n");
+    std::fprintf(out, "    }%s\n", last ? "" : ",");
+}
+
+static bool parseOptions(int argc, char** argv, BenchOptions& options)
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg {argv[i]};
+        bool has_value {i + 1 < argc};
+
+        if (arg == "--frames" && has_value)
+        {
+            options.frames = std::stoi(argv[++i]);
+        }
+        else if (arg == "--warmup" && has_value)
+        {
+            options.warmup = std::stoi(argv[++i]);
+        }
+        else if (arg == "--size" && has_value && std::sscanf(argv[i + 1], "%dx%d", &options.width, &options.height) == 2)
+        {
+            ++i;
+        }
+        else if (arg == "--obj" && has_value)
+        {
+            options.obj = argv[++i];
+        }
+        else if (arg == "--out" && has_value)
+        {
+            options.out = argv[++i];
+        }
+        else
+        {
+            return false;
+        }
+    }
+
+    return options.frames > 0 && options.warmup >= 0 && options.width > 0 && options.height > 0;
+}
+
+int main(int argc, char** argv)
+{
+    BenchOptions options;
+    if (!parseOptions(argc, argv, options))
+    {
+        std::fprintf(stderr, "Usage: %s [--frames N] [--warmup N] [--size WxH] [--obj file] [--out file.json]\n", argv[0]);
+        return 1;
+    }
+
+    Mesh blaster {getMeshFromObj(options.obj)};
+    optimizeMesh(blaster);
+
+    // 2 * 1024 * 512 and 2 * 724 * 724 triangles, both just over a million
+    Mesh grid {makeGrid(1024, 512)};
+    Mesh sphere {makeSphere(724, 724)};
+
+    std::vector<BenchScene> scenes;
+    scenes.push_back(BenchScene{"blaster", getMeshView(blaster), {placement(Vector3(0, 0, 0), 1.0f)}});
+    scenes.push_back(BenchScene{"stress_grid", getMeshView(grid), {placement(Vector3(0, 0, 0), 1.0f)}});
+    scenes.push_back(BenchScene{"stress_sphere", getMeshView(sphere), {placement(Vector3(0, 0, 0), 1.0f)}});
+
+    // The grid again from its structure-of-arrays copy
+    MeshSoA grid_soa {toSoA(grid)};
+    scenes.push_back(BenchScene{"stress_grid_soa", getMeshView(grid), {placement(Vector3(0, 0, 0), 1.0f)}, 1.0f, &grid_soa});
+
+    // The grid again, sampling a repeating texture through the mip chain
+    Texture checker {makeChecker(256)};
+    MeshView textured_grid {getMeshView(grid)};
+    textured_grid.texture = &checker;
+    scenes.push_back(BenchScene{"textured_grid", textured_grid, {placement(Vector3(0, 0, 0), 1.0f)}});
+
+    // Many small objects seen from inside the field: exercises the scene
+    // cull and per-object overhead
+    BenchScene field {"blaster_field", getMeshView(blaster), {}, 0.35f};
+    for (int z = 0; z < 32; ++z)
+    {
+        for (int x = 0; x < 32; ++x)
+        {
+            field.placements.push_back(placement(Vector3(x * 0.5f - 8.0f, 0, z * 0.5f - 8.0f), 1.0f));
+        }
+    }
+
+    // The same field as one instanced draw: the camera is set up once and
+    // every instance is culled on its own, with no scene BVH
+    BenchScene instanced_field {field};
+    instanced_field.name = "blaster_field_instanced";
+    instanced_field.instanced = true;
+
+    // The same field again, each object drawing the level of the blaster's
+    // LOD chain that its distance allows
+    LODChain blaster_lods {buildLODChain(blaster)};
+    BenchScene lod_field {field};
+    lod_field.name = "blaster_field_lod";
+    lod_field.mesh.lods = &blaster_lods;
+
+    // A wide open field where most objects are far away, the case LOD is for
+    BenchScene open_field {"open_field_lod", lod_field.mesh, {}, 0.35f};
+    for (int z = 0; z < 64; ++z)
+    {
+        for (int x = 0; x < 64; ++x)
+        {
+            open_field.placements.push_back(placement(Vector3(x * 2.0f - 64.0f, 0, z * 2.0f - 64.0f), 1.0f));
+        }
+    }
+
+    scenes.push_back(std::move(field));
+    scenes.push_back(std::move(instanced_field));
+    scenes.push_back(std::move(lod_field));
+    scenes.push_back(std::move(open_field));
+
+    std::vector<BenchResult> results;
+    for (const BenchScene& scene : scenes)
+    {
+        std::fprintf(stderr, "Running %s...\n", scene.name.c_str());
+        results.push_back(runScene(scene, options));
+    }
+
+    std::FILE* out {options.out.empty() ? stdout : std::fopen(options.out.c_str(), "w")};
+    if (out == nullptr)
+    {
+        std::fprintf(stderr, "Could not create %s\n", options.out.c_str());
+        return 1;
+    }
+
+    std::fprintf(out, "{\n");
+    std::fprintf(out, "  \"benchmark\": \"rast_bench\",\n");
+    std::fprintf(out, "  \"width\": %d,\n", options.width);
+    std::fprintf(out, "  \"height\": %d,\n", options.height);
+    std::fprintf(out, "  \"frames\": %d,\n", options.frames);
+    std::fprintf(out, "  \"warmup_frames\": %d,\n", options.warmup);
+    std::fprintf(out, "  \"hardware_threads\": %u,\n", std::thread::hardware_concurrency());
+    std::fprintf(out, "  \"simd\": \"%s\",\n", simdLevelName(simdLevel()));
+    std::fprintf(out, "  \"scenes\": [\n");
+    for (size_t i = 0; i < results.size(); ++i)
+    {
+        writeResult(out, results[i], i + 1 == results.size());
+    }
+    std::fprintf(out, "  ]\n}\n");
+
+    if (out != stdout) std::fclose(out);
+    return 0;
+}
@@ -0,0 +1,47 @@
+#ifndef ALIGNED_HPP
+#define ALIGNED_HPP
+
+#include <cstddef>
+#include <new>
+#include <vector>
+
+namespace RAST
+{
+    // Cache line, and wide enough for any SIMD load
+    constexpr size_t STREAM_ALIGNMENT {64};
+}
+
+template <typename T, size_t Alignment = RAST::STREAM_ALIGNMENT>
+struct AlignedAllocator
+{
+    using value_type = T;
+
+    template <typename U>
+    struct rebind
+    {
+        using other = AlignedAllocator<U, Alignment>;
+    };
+
+    AlignedAllocator() = default;
+
+    template <typename U>
+    AlignedAllocator(const AlignedAllocator<U, Alignment>&) {}
+
+    T* allocate(size_t n)
+    {
+        return static_cast<T*>(::operator new(n * sizeof(T), std::align_val_t(Alignment)));
+    }
+
+    void deallocate(T* p, size_t)
+    {
+        ::operator delete(p, std::align_val_t(Alignment));
+    }
+
+    template <typename U>
+    bool operator==(const AlignedAllocator<U, Alignment>&) const {return true;}
+};
+
+template <typename T>
+using AlignedVector = std::vector<T, AlignedAllocator<T>>;
+
+#endif
@@ -0,0 +1,105 @@
+#ifndef ARENA_HPP
+#define ARENA_HPP
+
+#include "aligned.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <type_traits>
+#include <vector>
+
+namespace RAST
+{
+    // Starting size; the arena grows to the largest frame it has seen
+    constexpr size_t FRAME_ARENA_BYTES {256 * 1024};
+}
+
+// Linear allocator for data that lives at most one frame. Allocation is a
+// bump of an atomic offset, so any thread may allocate; nothing is freed
+// until reset(). A frame that outgrows the block spills into separate heap
+// blocks, and the next reset() replaces everything with one block big
+// enough for that frame, so steady-state frames never touch the heap.
+class FrameArena
+{
+    public:
+    explicit FrameArena(size_t capacity = RAST::FRAME_ARENA_BYTES);
+
+    FrameArena(const FrameArena&) = delete;
+    FrameArena& operator=(const FrameArena&) = delete;
+
+    void* allocate(size_t size, size_t alignment);
+
+    // Invalidates every allocation; nothing may still be using one
+    void reset();
+
+    size_t capacity() const {return m_capacity;}
+    // Bytes handed out since the last reset, spills included
+    size_t used() const;
+
+    private:
+    AlignedVector<std::byte> m_block;
+    size_t m_capacity;
+    std::atomic<size_t> m_offset {0};
+
+    std::mutex m_spill_mutex;
+    std::vector<AlignedVector<std::byte>> m_spills;
+    size_t m_spill_bytes {0};
+
+    void* spill(size_t size, size_t alignment);
+};
+
+// Standard allocator over a FrameArena; deallocation is a no-op. A
+// default-constructed one has no arena and must not allocate
+template <typename T, size_t Alignment = alignof(T)>
+struct ArenaAllocator
+{
+    using value_type = T;
+
+    // Containers moved into take the arena along with the storage
+    using propagate_on_container_move_assignment = std::true_type;
+    using propagate_on_container_swap = std::true_type;
+
+    template <typename U>
+    struct rebind
+    {
+        using other = ArenaAllocator<U, Alignment>;
+    };
+
+    FrameArena* arena {nullptr};
+
+    ArenaAllocator() = default;
+    explicit ArenaAllocator(FrameArena& a) : arena(&a) {}
+
+    template <typename U>
+    ArenaAllocator(const ArenaAllocator<U, Alignment>& other) : arena(other.arena) {}
+
+    T* allocate(size_t n)
+    {
+        return static_cast<T*>(arena->allocate(n * sizeof(T), Alignment));
+    }
+
+    void deallocate(T*, size_t) {}
+
+    template <typename U>
+    bool operator==(const ArenaAllocator<U, Alignment>& other) const {return arena == other.arena;}
+};
+
+// Transient containers; rebind them before the arena is reset, while the
+// elements they destroy are still readable
+template <typename T>
+using FrameVector = std::vector<T, ArenaAllocator<T>>;
+
+template <typename T>
+using AlignedFrameVector = std::vector<T, ArenaAllocator<T, RAST::STREAM_ALIGNMENT>>;
+
+// Empties the container and points it at the arena; its old storage is
+// left to the arena rather than freed
+template <typename T, size_t Alignment>
+void rebindToArena(std::vector<T, ArenaAllocator<T, Alignment>>& v, FrameArena& arena)
+{
+    v = std::vector<T, ArenaAllocator<T, Alignment>>(ArenaAllocator<T, Alignment>(arena));
+}
+
+#endif
@@ -7,6 +7,8 @@
 #include "rast.hpp"
 #include "geometry.hpp"
 
+#include <array>
+
 struct PointNDC
 {
     PointNDC() : pos(Vector2()), color(ColorRGB{}) {}
@@ -19,6 +21,29 @@ struct PointNDC
     inline float y() const {return pos.y();} 
 };
 
+// Points p with dot(normal, p) + d >= 0 are on the inner side
+struct Plane
+{
+    Vector3 normal;
+    float d;
+};
+
+// Near, far, left, right, bottom, top
+using Frustum = std::array<Plane, 6>;
+
+// Everything the rendered image depends on; compared to detect camera changes
+struct CameraState
+{
+    Vector3 position;
+    Quaternion orientation;
+    float fov;
+    float aspect_ratio;
+    float near_plane;
+    float far_plane;
+};
+
+bool operator==(const CameraState& a, const CameraState& b);
+
 class Camera
 {
     public:
@@ -32,13 +57,31 @@ class Camera
     Camera(Vector3 pos, float fov, float ar, float np = 0.1, float fp = 1000.0)
     : position(pos), fov(fov), aspect_ratio(ar), near_plane(np), far_plane(fp) {}
 
+    CameraState state() const;
+    void setState(const CameraState& s);
     Matrix4x4 viewMatrix();
+    Frustum frustumPlanes();
     PointNDC getNDC(Vertex point);
 
     void pitch(float angle);
     void yaw(float angle);
 };
 
+enum class Containment
+{
+    Outside,
+    Intersecting,
+    Inside
+};
+
+// View to clip space. View space looks down -z; x and y are negated to keep
+// the screen orientation, and depth maps [near, far] to z/w in [0, 1].
+Matrix4x4 perspectiveMatrix(float fov, float aspect_ratio, float near_plane, float far_plane);
+
+// Conservative test of mesh bounds under a model matrix against the frustum
+bool isVisible(const Bounds& b, const Matrix4x4& model, const Frustum& frustum);
+Containment classify(const AABB& box, const Frustum& frustum);
+
 void takeInput(const bool *keyStates, Camera& camera);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,36 @@
+#ifndef CAMERAPATH_HPP
+#define CAMERAPATH_HPP
+
+#include "camera.hpp"
+
+#include <string>
+#include <vector>
+
+// Camera placement at one frame; angles in degrees, applied yaw then pitch
+struct CameraKey
+{
+    int frame;
+    Vector3 position;
+    float yaw;
+    float pitch;
+};
+
+// Keyframed camera motion, linearly interpolated between keys
+class CameraPath
+{
+    public:
+    explicit CameraPath(std::vector<CameraKey> keys);
+
+    // Frames 0 through the last key's frame
+    int frameCount() const;
+    void apply(int frame, Camera& camera) const;
+
+    private:
+    std::vector<CameraKey> m_keys;
+};
+
+// One key per line: "frame x y z yaw pitch". Blank lines and lines starting
+// with '#' are skipped. Throws std::runtime_error on malformed input.
+CameraPath loadCameraPath(const std::string& filename);
+
+#endif
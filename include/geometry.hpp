@@ -2,9 +2,13 @@
 #define GEOMETRY_HPP
 
 #include "math.hpp"
+#include "aligned.hpp"
 
 #include <vector>
 
+class Texture;
+struct LODChain;
+
 struct Point2D
 {
     int x;
@@ -16,6 +20,8 @@ struct Vertex
 {
     Vector3 pos;
     ColorRGB color;
+    // Texture coordinates; zero when the mesh has none
+    Vector2 uv {};
 };
 
 class Transform
@@ -34,15 +40,197 @@ class Transform
     Quaternion rotation;
 };
 
+struct AABB
+{
+    Vector3 min;
+    Vector3 max;
+};
+
+struct BoundingSphere
+{
+    Vector3 center;
+    float radius;
+};
+
+struct Bounds
+{
+    AABB box;
+    BoundingSphere sphere;
+};
+
+Bounds computeBounds(const Vertex* vertices, size_t count);
+
+// Box enclosing the transformed box
+AABB transformAABB(const AABB& box, const Matrix4x4& matrix);
+AABB mergeAABB(const AABB& a, const AABB& b);
+
 struct Mesh
 {
     std::vector<Vertex> vertices;
     std::vector<uint32_t> indices;
+    Bounds bounds {};
+
+    // Modulates the vertex colors when set; not owned
+    const Texture* texture {nullptr};
 };
 
+// Closed box over the given corners in a single color, 12 triangles
+Mesh boxMesh(const AABB& box, const ColorRGB& color);
+
 inline int getMeshLength(const Mesh& m)
 {
     return m.indices.size() / 3;
 }
 
+inline const Bounds& getBounds(const Mesh& m)
+{
+    return m.bounds;
+}
+
+// Strided view of the vertex positions for the batched MatMult
+inline PointStream getPointStream(const Mesh& m)
+{
+    static_assert(sizeof(Vertex) % sizeof(float) == 0);
+
+    constexpr size_t stride {sizeof(Vertex) / sizeof(float)};
+    if (m.vertices.empty()) return PointStream{nullptr, nullptr, nullptr, stride};
+
+    const float* base {m.vertices[0].pos.v.data()};
+    return PointStream{base, base + 1, base + 2, stride};
+}
+
+inline size_t getVertexCount(const Mesh& m)
+{
+    return m.vertices.size();
+}
+
+inline ColorRGB getVertexColor(const Mesh& m, size_t i)
+{
+    return m.vertices[i].color;
+}
+
+inline Vector2 getVertexUV(const Mesh& m, size_t i)
+{
+    return m.vertices[i].uv;
+}
+
+inline const Texture* getTexture(const Mesh& m)
+{
+    return m.texture;
+}
+
+// Non-owning Mesh-compatible view, e.g. over a memory-mapped mesh cache
+struct MeshView
+{
+    const Vertex* vertices;
+    size_t vertex_count;
+    const uint32_t* indices;
+    size_t index_count;
+    Bounds bounds;
+    const Texture* texture {nullptr};
+    // Coarser versions of the mesh; RenderScene picks one per object. Not owned
+    const LODChain* lods {nullptr};
+};
+
+inline MeshView getMeshView(const Mesh& m)
+{
+    return MeshView{m.vertices.data(), m.vertices.size(), m.indices.data(), m.indices.size(), m.bounds, m.texture};
+}
+
+inline const Bounds& getBounds(const MeshView& m)
+{
+    return m.bounds;
+}
+
+inline int getMeshLength(const MeshView& m)
+{
+    return m.index_count / 3;
+}
+
+inline PointStream getPointStream(const MeshView& m)
+{
+    constexpr size_t stride {sizeof(Vertex) / sizeof(float)};
+    if (m.vertex_count == 0) return PointStream{nullptr, nullptr, nullptr, stride};
+
+    const float* base {m.vertices[0].pos.v.data()};
+    return PointStream{base, base + 1, base + 2, stride};
+}
+
+inline size_t getVertexCount(const MeshView& m)
+{
+    return m.vertex_count;
+}
+
+inline ColorRGB getVertexColor(const MeshView& m, size_t i)
+{
+    return m.vertices[i].color;
+}
+
+inline Vector2 getVertexUV(const MeshView& m, size_t i)
+{
+    return m.vertices[i].uv;
+}
+
+inline const Texture* getTexture(const MeshView& m)
+{
+    return m.texture;
+}
+
+// Structure-of-arrays copy of a Mesh: each attribute is its own aligned
+// stream, so position-only passes never pull color through the cache
+struct MeshSoA
+{
+    AlignedVector<float> x;
+    AlignedVector<float> y;
+    AlignedVector<float> z;
+
+    AlignedVector<float> r;
+    AlignedVector<float> g;
+    AlignedVector<float> b;
+
+    AlignedVector<float> u;
+    AlignedVector<float> v;
+
+    std::vector<uint32_t> indices;
+    Bounds bounds {};
+    const Texture* texture {nullptr};
+};
+
+MeshSoA toSoA(const Mesh& m);
+
+inline const Bounds& getBounds(const MeshSoA& m)
+{
+    return m.bounds;
+}
+
+inline int getMeshLength(const MeshSoA& m)
+{
+    return m.indices.size() / 3;
+}
+
+inline PointStream getPointStream(const MeshSoA& m)
+{
+    return PointStream{m.x.data(), m.y.data(), m.z.data(), 1};
+}
+
+inline size_t getVertexCount(const MeshSoA& m)
+{
+    return m.x.size();
+}
+
+inline ColorRGB getVertexColor(const MeshSoA& m, size_t i)
+{
+    return ColorRGB(m.r[i], m.g[i], m.b[i]);
+}
+
+inline Vector2 getVertexUV(const MeshSoA& m, size_t i)
+{
+    return Vector2(m.u[i], m.v[i]);
+}
+
+inline const Texture* getTexture(const MeshSoA& m)
+{
+    return m.texture;
+}
+
 #endif
\ No newline at end of file
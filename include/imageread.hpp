@@ -0,0 +1,20 @@
+#ifndef IMAGEREAD_HPP
+#define IMAGEREAD_HPP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct Image
+{
+    int width {0};
+    int height {0};
+    // Packed ARGB, rows top to bottom
+    std::vector<uint32_t> pixels;
+};
+
+// Decodes a non-interlaced 8-bit PNG: gray, gray + alpha, RGB, RGBA or
+// palette. Throws std::runtime_error on I/O failure or any other format.
+Image readImage(const std::string& filename);
+
+#endif
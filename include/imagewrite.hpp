@@ -0,0 +1,23 @@
+#ifndef IMAGEWRITE_HPP
+#define IMAGEWRITE_HPP
+
+#include "raster.hpp"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+enum class ImageFormat
+{
+    PPM,
+    PNG
+};
+
+// Extension matching the format, without the dot
+const char* imageExtension(ImageFormat format);
+
+// Writes the color buffer as 8-bit RGB; throws std::runtime_error on I/O failure.
+// scratch is reused between calls so batch rendering does not reallocate.
+void writeImage(const std::string& filename, const Framebuffer& fb, ImageFormat format, std::vector<uint8_t>& scratch);
+
+#endif
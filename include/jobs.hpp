@@ -0,0 +1,177 @@
+#ifndef JOBS_HPP
+#define JOBS_HPP
+
+#include "arena.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Work-stealing job scheduler. Jobs form a graph through dependency
+// counters; each thread owns a deque it pops from the back, and idle
+// threads steal from the front of the others. Jobs live in a frame arena.
+
+struct Job
+{
+    explicit Job(FrameArena& arena)
+    : successors(ArenaAllocator<Job*>(arena)), spawned(ArenaAllocator<Job*>(arena)) {}
+
+    const char* name;
+
+    // The callable, copied into the arena
+    void* fn;
+    void (*invoke)(void* fn);
+    void (*destroy)(void* fn);
+
+    // Unfinished prerequisites, plus one until the job is released
+    std::atomic<int> pending {1};
+
+    // Guards successors against a prerequisite finishing mid-update
+    std::mutex mutex;
+    bool finished {false};
+    FrameVector<Job*> successors;
+
+    // Jobs added while this one ran, released when it finishes
+    FrameVector<Job*> spawned;
+};
+
+struct WorkerReport
+{
+    double busy_ms {0.0};
+    uint32_t jobs {0};
+    uint32_t steals {0};
+};
+
+// Per-thread activity between beginFrame and endFrame; entry 0 is the
+// thread calling run()
+struct JobReport
+{
+    double frame_ms {0.0};
+    std::vector<WorkerReport> workers;
+
+    double idleMs(size_t worker) const {return frame_ms - workers[worker].busy_ms;}
+    double utilization(size_t worker) const {return frame_ms > 0.0 ? workers[worker].busy_ms / frame_ms : 0.0;}
+};
+
+class JobSystem
+{
+    public:
+    // 0 picks one worker per hardware thread, minus the calling thread.
+    // Jobs allocate from arena, which the owner resets between frames and
+    // never while run() is going
+    explicit JobSystem(FrameArena& arena, unsigned thread_count = 0);
+    ~JobSystem();
+
+    JobSystem(const JobSystem&) = delete;
+    JobSystem& operator=(const JobSystem&) = delete;
+
+    // Names must be string literals; they label profiler zones. Jobs added
+    // from inside a running job are held until that job finishes, so the
+    // caller can wire their dependencies first
+    template <typename F>
+    Job* add(const char* name, F&& fn)
+    {
+        using Fn = std::decay_t<F>;
+
+        Fn* callable {new (m_arena.allocate(sizeof(Fn), alignof(Fn))) Fn(std::forward<F>(fn))};
+        return addJob(
+            name,
+            callable,
+            [](void* f) {(*static_cast<Fn*>(f))();},
+            [](void* f) {static_cast<Fn*>(f)->~Fn();}
+        );
+    }
+
+    // after starts once before has finished. after must not have started:
+    // call before run(), or from a job that after already depends on
+    void precede(Job* before, Job* after);
+
+    // Executes every added job on the workers and the calling thread and
+    // returns once all of them, including ones added meanwhile, finished
+    void run();
+
+    // One job per index, then run(); not callable from inside a job
+    template <typename F>
+    void parallelFor(size_t count, F&& fn)
+    {
+        if (m_workers.empty() || count == 1)
+        {
+            for (size_t i = 0; i < count; ++i)
+            {
+                fn(i);
+            }
+            return;
+        }
+
+        for (size_t i = 0; i < count; ++i)
+        {
+            add("parallel_for", [&fn, i] {fn(i);});
+        }
+        run();
+    }
+
+    // Threads taking part in run, including the caller
+    size_t size() const {return m_workers.size() + 1;}
+
+    void beginFrame();
+    void endFrame();
+    const JobReport& report() const {return m_report;}
+
+    private:
+    // The owner pops the back and thieves advance head; emptied in place,
+    // so the storage is reused every frame
+    struct WorkerQueue
+    {
+        std::mutex mutex;
+        std::vector<Job*> jobs;
+        size_t head {0};
+    };
+
+    // Written only by the owning thread; padded against false sharing
+    struct alignas(64) WorkerStats
+    {
+        uint64_t busy_ns {0};
+        uint32_t jobs {0};
+        uint32_t steals {0};
+    };
+
+    std::vector<std::thread> m_workers;
+    std::vector<std::unique_ptr<WorkerQueue>> m_queues;
+    std::vector<WorkerStats> m_stats;
+
+    FrameArena& m_arena;
+
+    // Jobs of the current run, destroyed when it ends
+    std::mutex m_jobs_mutex;
+    std::vector<Job*> m_jobs;
+    std::vector<Job*> m_held;
+
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::atomic<size_t> m_queued {0};
+    std::atomic<size_t> m_unfinished {0};
+    std::atomic<size_t> m_sleeping {0};
+    bool m_stop {false};
+
+    uint64_t m_frame_start {0};
+    JobReport m_report;
+
+    Job* addJob(const char* name, void* fn, void (*invoke)(void*), void (*destroy)(void*));
+    void release(Job* job);
+    void push(Job* job);
+    Job* findJob(size_t self);
+    void execute(Job* job, size_t self);
+    void finish(Job* job);
+    void waitForWork(bool caller);
+    void workerLoop(size_t index);
+};
+
+#endif
@@ -0,0 +1,49 @@
+#ifndef LOD_HPP
+#define LOD_HPP
+
+#include "geometry.hpp"
+
+#include <span>
+#include <vector>
+
+namespace RAST
+{
+    // Triangle ratios of the default chain, relative to the source mesh
+    constexpr float DEFAULT_LOD_RATIOS[] {0.5f, 0.25f, 0.1f, 0.03f};
+
+    // Largest simplification error allowed on screen, in pixels
+    constexpr float DEFAULT_LOD_ERROR_PIXELS {1.0f};
+}
+
+struct LODLevel
+{
+    MeshView mesh;
+    // Object-space deviation from the source surface, an upper estimate
+    float error;
+};
+
+// Level 0 is the source mesh, later levels are progressively coarser.
+// Levels are views: level 0 over the source itself, the others over meshes
+// or, for a chain read from the mesh cache, over the mapped file.
+struct LODChain
+{
+    std::vector<LODLevel> levels;
+    std::vector<Mesh> meshes;
+};
+
+// Quadric error metric edge collapse down to roughly target_triangles.
+// Border edges are weighted so open silhouettes keep their outline.
+// Writes the largest collapse error (object-space distance) to error_out;
+// it is measured without the border weight.
+Mesh simplifyMesh(const Mesh& m, size_t target_triangles, float* error_out = nullptr);
+
+// Levels are snapshots of one collapse sequence, coarsest last; levels too
+// close to the previous triangle count are dropped. Level 0 views m, so m
+// must outlive the chain.
+LODChain buildLODChain(const Mesh& m, std::span<const float> ratios = RAST::DEFAULT_LOD_RATIOS);
+
+// Coarsest level whose error projects below max_error_pixels, given the
+// screen pixels covered by one object-space unit at the object's distance
+size_t selectLOD(const LODChain& chain, float pixels_per_unit, float max_error_pixels = RAST::DEFAULT_LOD_ERROR_PIXELS);
+
+#endif
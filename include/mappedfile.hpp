@@ -0,0 +1,38 @@
+#ifndef MAPPEDFILE_HPP
+#define MAPPEDFILE_HPP
+
+#include <cstddef>
+#include <string>
+
+// Read-only memory mapping of a whole file
+class MappedFile
+{
+    public:
+    MappedFile() = default;
+    explicit MappedFile(const std::string& filename);
+    ~MappedFile();
+
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const char* data() const {return m_data;}
+    size_t size() const {return m_size;}
+
+    private:
+    const char* m_data {nullptr};
+    size_t m_size {0};
+
+#ifdef _WIN32
+    void* m_file {nullptr};
+    void* m_mapping {nullptr};
+#else
+    int m_fd {-1};
+#endif
+
+    void release();
+};
+
+#endif
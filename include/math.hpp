@@ -187,6 +187,36 @@ inline std::ostream& operator<<(std::ostream& os, const Vector3& v)
 
 using ColorRGB = Vector3;
 
+// Positions read with a stride in floats: 1 for separate x/y/z arrays,
+// or the element size when x/y/z sit inside a larger struct
+struct PointStream
+{
+    const float* x;
+    const float* y;
+    const float* z;
+    size_t stride;
+};
+
+// Separate output arrays for transformed x/y/z/w
+struct Vector4Stream
+{
+    float* x;
+    float* y;
+    float* z;
+    float* w;
+};
+
+enum class SimdLevel
+{
+    Scalar,
+    SSE,
+    AVX2
+};
+
+// Best instruction set supported by the running CPU
+SimdLevel simdLevel();
+const char* simdLevelName(SimdLevel level);
+
 class Matrix4x4
 {
     public:
@@ -210,6 +240,11 @@ class Matrix4x4
 
     Vector3 MatMult(Vector3 v);
     Matrix4x4 MatMult(Matrix4x4 other);
+
+    // Transforms count points with w = 1, 8 (AVX2) or 4 (SSE) at a time
+    void MatMult(const PointStream& in, size_t count, const Vector4Stream& out) const;
+    // Same over [begin, end), so one stream can be split across threads
+    void MatMult(const PointStream& in, size_t begin, size_t end, const Vector4Stream& out) const;
 };
 
 Matrix4x4 getInverse(Matrix4x4 matrix);
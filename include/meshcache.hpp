@@ -0,0 +1,114 @@
+#ifndef MESHCACHE_HPP
+#define MESHCACHE_HPP
+
+#include "geometry.hpp"
+#include "mappedfile.hpp"
+#include "parseobj.hpp"
+#include "meshopt.hpp"
+#include "texture.hpp"
+#include "lod.hpp"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+namespace RAST
+{
+    constexpr char MESH_CACHE_MAGIC[4] {'R', 'M', 'S', 'H'};
+    constexpr uint32_t MESH_CACHE_VERSION {5};
+
+    // MeshCacheHeader::flags
+    constexpr uint32_t MESH_CACHE_OPTIMIZED {1u << 0};
+    // The file holds an LOD table; a cache with LODs also serves loads without
+    constexpr uint32_t MESH_CACHE_LODS {1u << 1};
+
+    // Vertex and index blobs start on this boundary within the file
+    constexpr uint64_t MESH_CACHE_ALIGNMENT {64};
+}
+
+// On-disk layout: this header, then the raw Vertex array and the uint32_t
+// index array at the given offsets. The source size and mtime identify the
+// OBJ the cache was built from. With MESH_CACHE_LODS, lod_count
+// MeshCacheLOD entries at lod_offset describe the levels after level 0,
+// whose arrays follow in the same layout.
+struct MeshCacheHeader
+{
+    char magic[4];
+    uint32_t version;
+    uint32_t vertex_size;
+    uint32_t index_size;
+    uint32_t flags;
+    uint32_t lod_count;
+
+    uint64_t source_size;
+    int64_t source_mtime;
+
+    uint64_t vertex_count;
+    uint64_t vertex_offset;
+    uint64_t index_count;
+    uint64_t index_offset;
+    uint64_t lod_offset;
+
+    Bounds bounds;
+};
+
+struct MeshCacheLOD
+{
+    uint64_t vertex_count;
+    uint64_t vertex_offset;
+    uint64_t index_count;
+    uint64_t index_offset;
+    float error;
+    uint32_t reserved;
+
+    Bounds bounds;
+};
+
+// A mesh loaded through the cache. Normally its view points straight into
+// the mapped cache file; if no cache could be written it owns the parsed mesh.
+// It also owns the texture its OBJ's material names, if any, which is
+// reloaded every time, and the mesh's LOD chain when one was requested.
+class CachedMesh
+{
+    public:
+    CachedMesh() = default;
+    CachedMesh(CachedMesh&&) = default;
+    CachedMesh& operator=(CachedMesh&&) = default;
+
+    const MeshView& view() const {return m_view;}
+    bool isMapped() const {return m_file.data() != nullptr;}
+
+    private:
+    MappedFile m_file;
+    Mesh m_owned;
+    MeshView m_view {};
+    std::unique_ptr<Texture> m_texture;
+    std::unique_ptr<LODChain> m_lods;
+
+    friend CachedMesh loadCachedMesh(const std::string& filename, ObjParseMode mode, bool optimize, bool lods);
+};
+
+std::string getMeshCachePath(const std::string& filename);
+void writeMeshCache(
+    const std::string& cache_filename,
+    const Mesh& mesh,
+    uint64_t source_size,
+    int64_t source_mtime,
+    uint32_t flags,
+    const LODChain* lods = nullptr
+);
+
+// Maps <filename>.meshcache when it matches the OBJ's size and mtime,
+// otherwise parses the OBJ and writes the cache for the next run. With
+// optimize set the mesh goes through optimizeMesh() before it is cached.
+// A texture that cannot be loaded is logged and the mesh stays untextured.
+// With lods set the view points at an LOD chain; buildLODChain() only runs
+// when the cache is rebuilt, which stores the levels alongside the mesh.
+CachedMesh loadCachedMesh(
+    const std::string& filename,
+    ObjParseMode mode = ObjParseMode::Serial,
+    bool optimize = false,
+    bool lods = false
+);
+
+#endif
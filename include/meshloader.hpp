@@ -0,0 +1,98 @@
+#ifndef MESHLOADER_HPP
+#define MESHLOADER_HPP
+
+#include "meshcache.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+using MeshHandle = uint32_t;
+
+enum class MeshLoadState : uint8_t
+{
+    Queued,
+    Loading,
+    Ready,
+    Failed
+};
+
+// Loads meshes through the mesh cache on background threads. request()
+// returns a handle at once; view() stays null until the mesh is complete
+// and is then published with a single atomic store, so a reader sees
+// either nothing or the whole mesh.
+class MeshLoader
+{
+    public:
+    // 0 picks one loader per hardware thread, minus the calling thread,
+    // but at least one.
+    // on_finished runs on a loader thread after every load, e.g. to wake
+    // an event loop that sleeps while nothing changes
+    explicit MeshLoader(unsigned thread_count = 0, std::function<void()> on_finished = {});
+    // Drops queued requests and waits for the loads in progress
+    ~MeshLoader();
+
+    MeshLoader(const MeshLoader&) = delete;
+    MeshLoader& operator=(const MeshLoader&) = delete;
+
+    // Requesting a file again returns the first request's handle; both
+    // would share one cache file, so the first request's options stay
+    MeshHandle request(
+        const std::string& filename,
+        ObjParseMode mode = ObjParseMode::Serial,
+        bool optimize = false,
+        bool lods = false
+    );
+
+    MeshLoadState state(MeshHandle handle) const;
+    // Null until the load finished successfully; valid for the loader's lifetime
+    const MeshView* view(MeshHandle handle) const;
+    const std::string& filename(MeshHandle handle) const;
+    // Why the load failed, once state() is Failed
+    const std::string& error(MeshHandle handle) const;
+
+    // Appends the handles finished, loaded or failed, since the last call
+    void poll(std::vector<MeshHandle>& finished);
+
+    private:
+    struct Request
+    {
+        std::string filename;
+        ObjParseMode mode;
+        bool optimize;
+        bool lods;
+
+        std::atomic<MeshLoadState> state {MeshLoadState::Queued};
+        std::atomic<const MeshView*> view {nullptr};
+
+        // Written by the loading thread before state leaves Loading
+        CachedMesh mesh;
+        std::string error;
+    };
+
+    std::vector<std::thread> m_workers;
+    std::function<void()> m_on_finished;
+
+    // Requests never move, so loader threads hold plain pointers into them
+    mutable std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::vector<std::unique_ptr<Request>> m_requests;
+    std::unordered_map<std::string, MeshHandle> m_by_filename;
+    std::deque<MeshHandle> m_queue;
+    std::vector<MeshHandle> m_finished;
+    bool m_stop {false};
+
+    const Request& get(MeshHandle handle) const;
+    void load(Request& request);
+    void workerLoop();
+};
+
+#endif
@@ -0,0 +1,34 @@
+#ifndef MESHOPT_HPP
+#define MESHOPT_HPP
+
+#include "geometry.hpp"
+
+#include <cstdint>
+#include <vector>
+
+namespace RAST
+{
+    // Vertex cache size the triangle order is tuned for
+    constexpr int OPTIMIZE_CACHE_SIZE {32};
+
+    // FIFO cache size used to report ACMR, a typical GPU post-transform cache
+    constexpr int ACMR_CACHE_SIZE {16};
+}
+
+// Average cache miss ratio: vertices transformed per triangle through a
+// FIFO cache of the given size. 0.5 is ideal for large grids, 3.0 is no reuse.
+float computeACMR(const std::vector<uint32_t>& indices, size_t vertex_count, int cache_size = RAST::ACMR_CACHE_SIZE);
+
+// Merges vertices with identical position, color and texture coordinates
+void weldVertices(Mesh& m);
+
+// Reorders triangles for post-transform cache reuse (Forsyth)
+void optimizeVertexCache(Mesh& m);
+
+// Reorders vertices by first use in the index buffer and drops unused ones
+void optimizeVertexFetch(Mesh& m);
+
+// All three passes, logging ACMR before and after
+void optimizeMesh(Mesh& m);
+
+#endif
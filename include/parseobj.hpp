@@ -10,6 +10,17 @@
 #include <cstdint>
 #include <vector>
 
-Mesh getMeshFromObj(const std::string& filename);
+enum class ObjParseMode
+{
+    Serial,
+    Parallel    // Newline-aligned chunks parsed on all cores, for large files
+};
+
+Mesh getMeshFromObj(const std::string& filename, ObjParseMode mode = ObjParseMode::Serial);
+
+// map_Kd of the material the OBJ uses first, resolved against the .mtl's
+// directory; empty if it names none. One texture per mesh: later materials
+// are ignored. Throws std::runtime_error if the .mtl cannot be read.
+std::string getObjTexturePath(const std::string& filename);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,93 @@
+#ifndef PROFILER_HPP
+#define PROFILER_HPP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Frame instrumentation. Builds without RAST_PROFILE (release) get empty
+// inline stubs and the macros expand to nothing.
+
+struct ProfileZone
+{
+    const char* name;
+    double total_ms;
+    uint32_t calls;
+};
+
+struct ProfileCounter
+{
+    const char* name;
+    int64_t value;
+};
+
+// Totals of one finished frame, summed over all threads
+struct ProfileFrame
+{
+    double frame_ms {0.0};
+    std::vector<ProfileZone> zones;
+    std::vector<ProfileCounter> counters;
+};
+
+#ifdef RAST_PROFILE
+
+uint64_t profileNow();
+
+void profileBeginFrame();
+void profileEndFrame();
+
+// Labels the calling thread in captured traces; threads that never set a
+// name show up as "thread N", numbered by when they first recorded
+void profileSetThreadName(const std::string& name);
+
+// Names must be string literals; they are kept by pointer
+void profileRecord(const char* name, uint64_t start_ns, uint64_t end_ns);
+void profileCount(const char* name, int64_t value);
+
+// Records the next frame_count frames and writes them as Chrome
+// trace-event JSON (chrome://tracing, Perfetto) when the last one ends
+void profileStartCapture(int frame_count, const std::string& filename);
+// True until the capture's last frame has ended
+bool profileCapturing();
+
+const ProfileFrame& profileLastFrame();
+
+class ProfileScope
+{
+    public:
+    explicit ProfileScope(const char* name) : m_name(name), m_start(profileNow()) {}
+    ~ProfileScope() {profileRecord(m_name, m_start, profileNow());}
+
+    ProfileScope(const ProfileScope&) = delete;
+    ProfileScope& operator=(const ProfileScope&) = delete;
+
+    private:
+    const char* m_name;
+    uint64_t m_start;
+};
+
+#define RAST_PROFILE_CONCAT_(a, b) a##b
+#define RAST_PROFILE_CONCAT(a, b) RAST_PROFILE_CONCAT_(a, b)
+#define RAST_PROFILE_SCOPE(name) ProfileScope RAST_PROFILE_CONCAT(profile_scope_, __LINE__) {name}
+#define RAST_PROFILE_COUNT(name, value) profileCount(name, (int64_t)(value))
+
+#else
+
+inline void profileBeginFrame() {}
+inline void profileEndFrame() {}
+inline void profileSetThreadName(const std::string&) {}
+inline void profileStartCapture(int, const std::string&) {}
+inline bool profileCapturing() {return false;}
+
+inline const ProfileFrame& profileLastFrame()
+{
+    static const ProfileFrame empty;
+    return empty;
+}
+
+#define RAST_PROFILE_SCOPE(name) ((void)0)
+#define RAST_PROFILE_COUNT(name, value) ((void)0)
+
+#endif
+
+#endif
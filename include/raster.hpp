@@ -0,0 +1,119 @@
+#ifndef RASTER_HPP
+#define RASTER_HPP
+
+#include "math.hpp"
+#include "arena.hpp"
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+class Texture;
+
+namespace RAST
+{
+    // Sub-pixel precision of the fixed-point edge functions
+    constexpr int SUBPIXEL_BITS {8};
+    constexpr int SUBPIXEL_ONE {1 << SUBPIXEL_BITS};
+
+    // Largest screen coordinate the fixed-point setup accepts
+    constexpr float GUARD_BAND {16384.0f};
+
+    // Screen tiles rasterized independently by the worker threads
+    constexpr int TILE_SIZE {64};
+}
+
+struct RasterVertex
+{
+    float x;
+    float y;
+    float depth;
+    ColorRGB color;
+};
+
+// 1/w and the texture coordinates over w, which unlike the coordinates
+// themselves vary linearly across the screen
+struct RasterTexCoords
+{
+    float inv_w;
+    float u_w;
+    float v_w;
+};
+
+// Kept apart from RasterTriangle so untextured triangles stay as small as before
+struct TexturedTriangle
+{
+    RasterTexCoords t[3];
+    const Texture* texture;
+};
+
+struct RasterTriangle
+{
+    RasterVertex v[3];
+    const TexturedTriangle* textured {nullptr};
+};
+
+struct ScissorRect
+{
+    int x0;
+    int y0;
+    int x1;
+    int y1;
+};
+
+class Framebuffer
+{
+    public:
+    Framebuffer(int w, int h)
+    : width(w), height(h), color(w * h), depth(w * h) {}
+
+    void clear(uint32_t c, float d = 1.0f);
+    void clear(const ScissorRect& rect, uint32_t c, float d = 1.0f);
+
+    int width;
+    int height;
+    std::vector<uint32_t> color;
+    std::vector<float> depth;
+};
+
+uint32_t packARGB(const ColorRGB& c);
+
+// Depth-tested rasterization with a top-left fill rule, limited to the scissor rect.
+// A textured triangle is sampled perspective-correct, modulating the vertex color
+void rasterizeTriangle(
+    Framebuffer& fb,
+    const RasterVertex& v1,
+    const RasterVertex& v2,
+    const RasterVertex& v3,
+    const ScissorRect& scissor,
+    const TexturedTriangle* textured = nullptr
+);
+
+// Assigns each triangle to every tile its bounding box overlaps
+class TileBinner
+{
+    public:
+    TileBinner(int width, int height);
+
+    // Bins live in the arena until its next reset
+    void bin(std::span<const RasterTriangle> triangles, FrameArena& arena);
+
+    int tileCount() const {return m_tiles_x * m_tiles_y;}
+    ScissorRect tileRect(int tile) const;
+    std::span<const uint32_t> tileBin(int tile) const
+    {
+        return {m_entries + m_offsets[tile], m_entries + m_offsets[tile + 1]};
+    }
+
+    private:
+    int m_width;
+    int m_height;
+    int m_tiles_x;
+    int m_tiles_y;
+
+    // All bins back to back, tile t at [m_offsets[t], m_offsets[t + 1])
+    std::vector<uint32_t> m_offsets;
+    uint32_t* m_entries {nullptr};
+};
+
+#endif
@@ -3,40 +3,291 @@
 
 #include "geometry.hpp"
 #include "camera.hpp"
+#include "raster.hpp"
+#include "jobs.hpp"
+#include "lod.hpp"
+#include "profiler.hpp"
 
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <string>
 #include <vector>
 
-SDL_Vertex getSDLVertex(const PointNDC& point);
+class Scene;
 
-struct Renderable
+SDL_Vertex getSDLVertex(const PointNDC& point, int width, int height);
+RasterVertex getRasterVertex(const PointNDC& point, float depth, int width, int height);
+
+enum class RenderBackend
+{
+    SDLGeometry,    // Triangles are submitted to SDL_RenderGeometry
+    Software        // Triangles are rasterized into a CPU framebuffer with depth testing
+};
+
+template <typename MeshType>
+struct BasicRenderable
 {
-    Mesh* mesh;
+    MeshType* mesh;
     Transform transform;
 };
 
+using Renderable = BasicRenderable<Mesh>;
+using RenderableSoA = BasicRenderable<MeshSoA>;
+using RenderableView = BasicRenderable<const MeshView>;
+
+namespace RAST
+{
+    // Clip-space outcodes; a triangle whose vertices share a frustum bit is culled
+    constexpr uint8_t CLIP_NEAR {1 << 0};
+    constexpr uint8_t CLIP_FAR {1 << 1};
+    constexpr uint8_t CLIP_LEFT {1 << 2};
+    constexpr uint8_t CLIP_RIGHT {1 << 3};
+    constexpr uint8_t CLIP_BOTTOM {1 << 4};
+    constexpr uint8_t CLIP_TOP {1 << 5};
+    constexpr uint8_t CLIP_FRUSTUM {0x3F};
+
+    // Outside the rasterizer guard band; only these triangles and those
+    // crossing the near plane are clipped
+    constexpr uint8_t CLIP_GUARD {1 << 6};
+
+    // Work items of the parallel vertex and setup stages; meshes smaller
+    // than one chunk stay on the calling thread
+    constexpr size_t VERTEX_CHUNK {16384};
+    constexpr size_t SETUP_CHUNK {8192};
+}
+
+// Homogeneous clip space: inside the frustum -w <= x, y <= w and 0 <= z <= w
+struct ClipVertex
+{
+    float x;
+    float y;
+    float z;
+    float w;
+    ColorRGB color;
+};
+
+struct ProcessedVertex
+{
+    ClipVertex clip;
+    uint8_t outcode;
+};
+
+// Triangle setup output of one chunk, merged in chunk order
+struct SetupSlot
+{
+    // Negative entries -(k + 1) refer to the k-th vertex made by clipping
+    FrameVector<int> indices;
+    FrameVector<RasterVertex> raster_vertices;
+    FrameVector<RasterTexCoords> raster_uv;
+    FrameVector<SDL_Vertex> sdl_vertices;
+
+    size_t culled_depth {0};
+    size_t culled_offscreen {0};
+    size_t clipped {0};
+
+    // Where the merge places this slot's indices and clipped vertices
+    size_t index_offset {0};
+    size_t vertex_base {0};
+
+    void rebind(FrameArena& arena)
+    {
+        rebindToArena(indices, arena);
+        rebindToArena(raster_vertices, arena);
+        rebindToArena(raster_uv, arena);
+        rebindToArena(sdl_vertices, arena);
+    }
+};
+
+// Vertex stage output, one entry per mesh vertex in each stream
+struct VertexStreams
+{
+    AlignedFrameVector<float> x;
+    AlignedFrameVector<float> y;
+    AlignedFrameVector<float> z;
+    AlignedFrameVector<float> w;
+
+    void resize(size_t n)
+    {
+        x.resize(n);
+        y.resize(n);
+        z.resize(n);
+        w.resize(n);
+    }
+
+    Vector4Stream stream()
+    {
+        return Vector4Stream{x.data(), y.data(), z.data(), w.data()};
+    }
+
+    void rebind(FrameArena& arena)
+    {
+        rebindToArena(x, arena);
+        rebindToArena(y, arena);
+        rebindToArena(z, arena);
+        rebindToArena(w, arena);
+    }
+};
+
+// Buffers of one mesh going through the vertex and setup stages, held in
+// the frame arena. Scene objects each get their own so their jobs overlap
+struct MeshWork
+{
+    Matrix4x4 mvp;
+    const Texture* texture {nullptr};
+
+    // The LOD level a scene object draws instead of its mesh, and the
+    // source triangles that saves
+    MeshView lod_view {};
+    size_t lod_skipped {0};
+
+    size_t vertex_count {0};
+    size_t triangle_count {0};
+    size_t vertex_chunks {0};
+    size_t slot_count {0};
+
+    VertexStreams clip;
+    FrameVector<ProcessedVertex> processed;
+
+    // Screen vertices for the active backend; clipping appends past vertex_count
+    FrameVector<RasterVertex> raster_vertices;
+    FrameVector<SDL_Vertex> sdl_vertices;
+
+    // Only filled for a textured mesh on the software backend: the mesh
+    // texcoords for clipping, their screen terms alongside raster_vertices,
+    // and one entry per queued triangle
+    FrameVector<Vector2> uv;
+    FrameVector<RasterTexCoords> raster_uv;
+    FrameVector<TexturedTriangle> textured;
+
+    FrameVector<SetupSlot> slots;
+    FrameVector<int> indices;
+
+    // First slot of this object's triangles in the frame-wide list
+    size_t triangle_offset {0};
+
+    // Job time spent per stage, summed over the chunks
+    std::atomic<uint64_t> vertex_ns {0};
+    std::atomic<uint64_t> setup_ns {0};
+
+    // Empty buffers in the arena; needed before first use and before every reset
+    void rebind(FrameArena& arena)
+    {
+        clip.rebind(arena);
+        rebindToArena(processed, arena);
+        rebindToArena(raster_vertices, arena);
+        rebindToArena(sdl_vertices, arena);
+        rebindToArena(uv, arena);
+        rebindToArena(raster_uv, arena);
+        rebindToArena(textured, arena);
+        rebindToArena(slots, arena);
+        rebindToArena(indices, arena);
+    }
+};
+
+struct RenderStats
+{
+    size_t vertices_transformed {0};
+    size_t indices_processed {0};
+    size_t triangles_submitted {0};
+    size_t triangles_culled_depth {0};
+    size_t triangles_culled_offscreen {0};
+    size_t triangles_clipped {0};
+    size_t objects_culled {0};
+    // Source triangles left out because a coarser LOD level was drawn
+    size_t triangles_lod_skipped {0};
+
+    // Time per pipeline stage in milliseconds; wall time, except vertex and
+    // setup under RenderScene, where they sum the overlapping jobs
+    double cull_ms {0.0};
+    double vertex_ms {0.0};
+    double setup_ms {0.0};
+    double bin_ms {0.0};
+    double raster_ms {0.0};
+    // Present calls since the previous frame, from whichever thread made them
+    double present_ms {0.0};
+
+    // Transformed vertices per index; 1.0 means no reuse at all
+    inline float transformRatio() const
+    {
+        return indices_processed ? (float)vertices_transformed / indices_processed : 0.0f;
+    }
+};
+
 struct CachedCamera
 {
     float far_plane;
     float near_plane;
     float fov;
     Matrix4x4 view_matrix;
+    Frustum frustum;
+
+    // Projection scales, hoisted out of the per-vertex NDC step
+    float x_scale;
+    float y_scale;
+
+    // Projection times view; one multiply with a model matrix gives the MVP
+    Matrix4x4 view_projection;
+
+    // Guard band half-extents in NDC units
+    float guard_x;
+    float guard_y;
 };
 
 class Renderer
 {
     public:
     Renderer() = delete;
-    Renderer(SDL_Window* w, SDL_Renderer* r, Camera* c) 
-    : m_renderer(r), camera(c) 
-    {
-        int width = 0, height = 0;
-        SDL_GetWindowSize(w, &width, &height);
-        m_width = width;
-        m_height = height;
-    }
+    Renderer(SDL_Window* w, SDL_Renderer* r, Camera* c, RenderBackend backend = RenderBackend::SDLGeometry);
+    // Headless: software backend into an in-memory framebuffer, nothing presented
+    Renderer(int width, int height, Camera* c);
+    ~Renderer();
+
+    Renderer(const Renderer&) = delete;
+    Renderer& operator=(const Renderer&) = delete;
+
+    void BeginFrame();
+    // Rasterizes, then presents on the calling thread
+    void EndFrame();
+
+    // Pipelined split of EndFrame: the rendering thread finishes the frame
+    // and hands it over, the thread owning the window shows it with
+    // Present. Only the software backend keeps a frame to hand over.
+    void FinishFrame();
+    void Present();
 
     void Rendermesh(const Mesh& m);
+    void Rendermesh(const MeshSoA& m);
+    void Rendermesh(const MeshView& m);
     void RenderObject(const Renderable& r);
+    void RenderObject(const RenderableSoA& r);
+    void RenderObject(const RenderableView& r);
+    // Culls through the scene BVH, then draws every visible object. Meshes
+    // with an LOD chain draw the coarsest level whose error stays under the
+    // LOD pixel threshold
+    void RenderScene(Scene& scene);
+
+    // One mesh drawn at many placements with a single camera setup
+    void RenderInstanced(const Mesh& m, std::span<const Transform> instances);
+    void RenderInstanced(const Mesh& m, std::span<const Matrix4x4> models);
+    void RenderInstanced(const MeshSoA& m, std::span<const Transform> instances);
+    void RenderInstanced(const MeshSoA& m, std::span<const Matrix4x4> models);
+    void RenderInstanced(const MeshView& m, std::span<const Transform> instances);
+    void RenderInstanced(const MeshView& m, std::span<const Matrix4x4> models);
+
+    const RenderStats& stats() const {return m_stats;}
+    // Busy and idle time per job thread over the last finished frame
+    const JobReport& jobReport() const {return m_jobs->report();}
+    // Headless frames only; a windowed frame is handed over once finished
+    const Framebuffer& framebuffer() const {return m_framebuffer;}
+    void resetStats() {m_stats = RenderStats{};}
+
+    void setLODErrorPixels(float pixels) {m_lod_error_pixels = pixels;}
+
+    // Last frame's profiler zones and counters drawn over the image; needs RAST_PROFILE
+    void setProfileOverlay(bool enabled) {m_profile_overlay = enabled;}
+    bool profileOverlay() const {return m_profile_overlay;}
 
     private:
     SDL_Renderer* m_renderer;
@@ -44,10 +295,92 @@ class Renderer
     int m_width;
     int m_height;
 
+    RenderBackend m_backend;
+    RenderStats m_stats;
+    float m_lod_error_pixels {RAST::DEFAULT_LOD_ERROR_PIXELS};
+    std::atomic<bool> m_profile_overlay {false};
+
+    // Software backend targets, presented through one streaming texture
+    Framebuffer m_framebuffer;
+    SDL_Texture* m_frame_texture {nullptr};
+
+    // Last finished frame and overlay, waiting for Present
+    std::mutex m_present_mutex;
+    std::vector<uint32_t> m_present_color;
+    std::vector<std::string> m_overlay_lines;
+    std::vector<std::string> m_overlay_build;
+    bool m_frame_fresh {false};
+    // Time spent in Present since the rendering thread last collected it
+    std::atomic<uint64_t> m_present_ns {0};
+
+    // Transient per-frame data, the job graph included; reset in BeginFrame.
+    // Declared before every container allocating from it
+    FrameArena m_arena;
+
+    // Frame-wide triangle list, binned into tiles and rasterized in EndFrame
+    FrameVector<RasterTriangle> m_triangles;
+    TileBinner m_binner;
+
+    // Runs the scene graph, the chunked vertex and setup stages, and the tiles
+    std::unique_ptr<JobSystem> m_jobs;
+
+    // Immediate-mode draws share one set of buffers; scene objects get one each
+    MeshWork m_work;
+    std::vector<std::unique_ptr<MeshWork>> m_object_work;
+
+    // Scene objects that survived the BVH cull this call
+    std::vector<uint32_t> m_visible;
+
+    // Drawn for scene objects whose mesh has not arrived, stretched over
+    // their placeholder box
+    Mesh m_placeholder_mesh {boxMesh(AABB{Vector3(-1, -1, -1), Vector3(1, 1, 1)}, ColorRGB(0.35f, 0.35f, 0.35f))};
+    MeshView m_placeholder {getMeshView(m_placeholder_mesh)};
+
+    // Instances accumulated into one SDL_RenderGeometry call
+    std::vector<SDL_Vertex> m_instance_vertices;
+    std::vector<int> m_instance_indices;
+
+    // Defined in renderer.cpp for Mesh, MeshSoA and MeshView
+    template <typename MeshType>
+    void prepareWork(const MeshType& m, MeshWork& w);
+    template <typename MeshType>
+    void transformVertices(const MeshType& m, const Matrix4x4& mvp, const CachedCamera& c, MeshWork& w, size_t chunk) const;
+    template <typename MeshType>
+    void setupChunk(const MeshType& m, const CachedCamera& c, MeshWork& w, size_t slot) const;
+    template <typename MeshType>
+    void processVertices(const MeshType& m, Matrix4x4 mvp, const CachedCamera& c);
+    template <typename MeshType>
+    void setupTriangles(const MeshType& m, const CachedCamera& c);
+    template <typename MeshType>
+    void renderMesh(const MeshType& m, Matrix4x4 mvp, const CachedCamera& c);
+    template <typename MeshType>
+    void renderObject(const BasicRenderable<MeshType>& r);
+    template <typename MeshType, typename InstanceType>
+    void renderInstanced(const MeshType& m, std::span<const InstanceType> instances);
+
+    void appendInstanceBatch();
+    void flushInstanceBatch();
+
+    void mergeSetupSlots(MeshWork& w) const;
+    void copySlotIndices(MeshWork& w, size_t slot) const;
+    void writeTriangles(MeshWork& w, RasterTriangle* out) const;
+    void countWork(const MeshWork& w);
+    // Adds one object's jobs from inside a running job; returns its last job
+    Job* scheduleObject(const MeshView& m, const CachedCamera& c, MeshWork& w);
+
+    void submitBatch(const MeshWork& w);
+    void queueTriangles(MeshWork& w);
+    void rasterizeTiles();
+    void publishFrame();
+    void closeFrame();
+    void formatProfileOverlay();
+
     CachedCamera cacheCamera();
-    PointNDC getNDC(const Vertex& point, const CachedCamera& c);
-    bool inFrustrum(const Vertex& v, const CachedCamera& c);
-    bool inScreen(const PointNDC& p);
+    // uv is null unless the mesh is textured
+    int emitVertex(const ClipVertex& v, const Vector2* uv, SetupSlot& slot) const;
+    void clipTriangle(
+        const MeshWork& w, uint32_t i1, uint32_t i2, uint32_t i3, uint8_t outcodes, const CachedCamera& c, SetupSlot& slot
+    ) const;
 };
 
 
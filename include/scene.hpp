@@ -0,0 +1,85 @@
+#ifndef SCENE_HPP
+#define SCENE_HPP
+
+#include "geometry.hpp"
+#include "camera.hpp"
+#include "renderer.hpp"
+
+#include <cstdint>
+#include <vector>
+
+using ObjectId = uint32_t;
+
+struct SceneObject
+{
+    // Null while the mesh is still loading
+    RenderableView renderable;
+    Matrix4x4 model;
+    // Object space: the mesh bounds, or the placeholder box until it arrives
+    AABB local_box;
+    AABB world_box;
+};
+
+// Binary BVH node; leaves hold exactly one object
+struct BVHNode
+{
+    static constexpr uint32_t NONE {~0u};
+
+    AABB box;
+    uint32_t parent {NONE};
+    uint32_t left {NONE};
+    uint32_t right {NONE};
+    uint32_t object {NONE};
+
+    bool isLeaf() const {return object != NONE;}
+};
+
+// Owns placed Renderables and a BVH over their world-space boxes
+class Scene
+{
+    public:
+    ObjectId add(const MeshView* mesh, const Transform& transform);
+    // Object without a mesh yet, drawn as the placeholder box until setMesh
+    ObjectId add(const AABB& placeholder, const Transform& transform);
+
+    // Swaps in the object's mesh, e.g. once an asynchronous load finished
+    void setMesh(ObjectId id, const MeshView* mesh);
+
+    // Refits the BVH along the path from the object's leaf to the root
+    void setTransform(ObjectId id, const Transform& transform);
+
+    const Transform& transform(ObjectId id) const {return m_objects[id].renderable.transform;}
+    const SceneObject& object(ObjectId id) const {return m_objects[id];}
+    size_t size() const {return m_objects.size();}
+
+    // Bumped by every add and setTransform, so the update loop can skip unchanged frames
+    uint64_t revision() const {return m_revision;}
+
+    // Rebuilds the BVH from scratch, restoring quality after heavy refitting
+    void rebuild();
+
+    // Appends the ids of objects whose world box touches the frustum
+    void cull(const Frustum& frustum, std::vector<ObjectId>& visible);
+
+    // BVH nodes tested by the last cull
+    size_t lastCullNodeTests() const {return m_node_tests;}
+
+    private:
+    std::vector<SceneObject> m_objects;
+    std::vector<BVHNode> m_nodes;
+    std::vector<uint32_t> m_leaf_of;
+    uint32_t m_root {BVHNode::NONE};
+    bool m_needs_build {false};
+    uint64_t m_revision {0};
+
+    // Scratch space reused across builds and traversals
+    std::vector<ObjectId> m_build_order;
+    std::vector<uint32_t> m_stack;
+    size_t m_node_tests {0};
+
+    uint32_t build(uint32_t parent, size_t begin, size_t end);
+    void refit(ObjectId id);
+    void appendSubtree(uint32_t node, std::vector<ObjectId>& visible);
+};
+
+#endif
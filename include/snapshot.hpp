@@ -0,0 +1,88 @@
+#ifndef SNAPSHOT_HPP
+#define SNAPSHOT_HPP
+
+#include "camera.hpp"
+#include "scene.hpp"
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+// Everything the render thread reads from the update thread, copied once
+// per update so neither side waits on the other
+struct SceneSnapshot
+{
+    CameraState camera;
+
+    // Indexed by ObjectId; a mesh is null while it is still loading
+    std::vector<Transform> transforms;
+    std::vector<const MeshView*> meshes;
+};
+
+void captureSnapshot(const Camera& camera, const Scene& scene, SceneSnapshot& out);
+
+// Brings a render-side camera and scene replica up to the snapshot; only
+// objects whose transform or mesh changed refit the BVH
+void applySnapshot(const SceneSnapshot& snapshot, Camera& camera, Scene& scene);
+
+// Single writer, single reader. The writer fills back() and publishes it;
+// the reader swaps the newest published slot into front(). Neither side
+// blocks, and the reader never sees a half-written value.
+template <typename T>
+class TripleBuffer
+{
+    public:
+    T& back() {return m_slots[m_back];}
+
+    void publish()
+    {
+        uint32_t previous {m_ready.exchange(m_back | FRESH, std::memory_order_acq_rel)};
+        m_back = previous & INDEX;
+
+        m_sequence.fetch_add(1, std::memory_order_release);
+        m_sequence.notify_one();
+    }
+
+    // True if a slot newer than the current front() was taken
+    bool acquire()
+    {
+        if (!(m_ready.load(std::memory_order_acquire) & FRESH)) return false;
+
+        uint32_t previous {m_ready.exchange(m_front, std::memory_order_acq_rel)};
+        m_front = previous & INDEX;
+        return true;
+    }
+
+    const T& front() const {return m_slots[m_front];}
+
+    // Blocks the reader until a publish or close after the given sequence
+    uint64_t wait(uint64_t seen)
+    {
+        m_sequence.wait(seen, std::memory_order_acquire);
+        return m_sequence.load(std::memory_order_acquire);
+    }
+
+    void close()
+    {
+        m_closed.store(true, std::memory_order_release);
+        m_sequence.fetch_add(1, std::memory_order_release);
+        m_sequence.notify_all();
+    }
+
+    bool closed() const {return m_closed.load(std::memory_order_acquire);}
+
+    private:
+    static constexpr uint32_t INDEX {3};
+    static constexpr uint32_t FRESH {4};
+
+    std::array<T, 3> m_slots;
+    uint32_t m_back {0};
+    uint32_t m_front {1};
+    std::atomic<uint32_t> m_ready {2};
+
+    std::atomic<uint64_t> m_sequence {0};
+    std::atomic<bool> m_closed {false};
+};
+
+#endif
@@ -0,0 +1,75 @@
+#ifndef TEXTURE_HPP
+#define TEXTURE_HPP
+
+#include "math.hpp"
+#include "aligned.hpp"
+
+#include <cstdint>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace RAST
+{
+    // Texels per side of a storage tile; 8x8 ARGB texels are 4 cache lines
+    constexpr int TEXTURE_TILE_BITS {3};
+    constexpr int TEXTURE_TILE {1 << TEXTURE_TILE_BITS};
+}
+
+// Mip-mapped ARGB texture. Each level is stored in 8x8 tiles, tiles in row
+// order and texels inside a tile in Morton order, so a bilinear footprint
+// and its neighbours along either axis share cache lines.
+class Texture
+{
+    public:
+    // texels: width * height packed ARGB, rows top to bottom. The chain is
+    // box-filtered down to 1x1
+    Texture(int width, int height, std::span<const uint32_t> texels);
+
+    int levels() const {return (int)m_levels.size();}
+    int width(int level = 0) const {return m_levels[level].width;}
+    int height(int level = 0) const {return m_levels[level].height;}
+
+    // Nearest level for a footprint whose larger screen-axis derivative
+    // spans sqrt(rho2) base-level texels per pixel
+    int selectLevel(float rho2) const;
+
+    uint32_t texel(int x, int y, int level) const
+    {
+        const Level& l {m_levels[level]};
+        return m_texels[l.offset + tiledIndex(x, y, l.tiles_x)];
+    }
+
+    // Bilinear within the level, repeating outside [0, 1)
+    ColorRGB sample(float u, float v, int level) const;
+
+    private:
+    struct Level
+    {
+        int width;
+        int height;
+        int tiles_x;
+        size_t offset;
+    };
+
+    std::vector<Level> m_levels;
+    AlignedVector<uint32_t> m_texels;
+
+    static size_t tiledIndex(int x, int y, int tiles_x)
+    {
+        // Interleaves the 3 low bits of x and y
+        auto spread = [](uint32_t b) {
+            b = (b | (b << 2)) & 0x33u;
+            return (b | (b << 1)) & 0x55u;
+        };
+
+        constexpr int mask {RAST::TEXTURE_TILE - 1};
+        size_t tile {(size_t)(y >> RAST::TEXTURE_TILE_BITS) * tiles_x + (x >> RAST::TEXTURE_TILE_BITS)};
+        return tile << (2 * RAST::TEXTURE_TILE_BITS) | spread(x & mask) | spread(y & mask) << 1;
+    }
+};
+
+// Reads an image through readImage(); throws std::runtime_error on failure
+Texture loadTexture(const std::string& filename);
+
+#endif
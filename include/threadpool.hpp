@@ -0,0 +1,61 @@
+#ifndef THREADPOOL_HPP
+#define THREADPOOL_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+class ThreadPool
+{
+    public:
+    // 0 picks one worker per hardware thread, minus the calling thread
+    explicit ThreadPool(unsigned thread_count = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // Runs fn(i) for every i in [0, count) on the workers and the calling
+    // thread, and returns once all of them have finished. Calls from
+    // several threads at once take turns
+    template <typename F>
+    void parallelFor(size_t count, F&& fn)
+    {
+        auto call = [](void* ctx, size_t i) {
+            (*static_cast<std::remove_reference_t<F>*>(ctx))(i);
+        };
+        run(count, call, &fn);
+    }
+
+    // Threads taking part in parallelFor, including the caller
+    size_t size() const {return m_workers.size() + 1;}
+
+    private:
+    using Task = void (*)(void*, size_t);
+
+    std::vector<std::thread> m_workers;
+    // Held for a whole parallelFor, so only one caller hands out work
+    std::mutex m_run_mutex;
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::condition_variable m_done;
+
+    Task m_task {nullptr};
+    void* m_context {nullptr};
+    size_t m_count {0};
+    std::atomic<size_t> m_next {0};
+    size_t m_busy {0};
+    uint64_t m_generation {0};
+    bool m_stop {false};
+
+    void run(size_t count, Task task, void* context);
+    void drain();
+    void workerLoop();
+};
+
+#endif
@@ -7,18 +7,124 @@
 #include "include/geometry.hpp"
 #include "include/renderer.hpp"
 #include "include/parseobj.hpp"
+#include "include/meshcache.hpp"
+#include "include/meshloader.hpp"
+#include "include/scene.hpp"
+#include "include/camerapath.hpp"
+#include "include/imagewrite.hpp"
+#include "include/profiler.hpp"
+#include "include/snapshot.hpp"
 
 #include <memory>
 #include <cstdint>
 #include <array>
 #include <iostream>
 #include <vector>
+#include <string>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <stdexcept>
 
 #include <algorithm>
+#include <thread>
 
 
-int main()
+// Renders every frame of a camera path into out_dir without opening a window
+static int runHeadless(int argc, char* argv[])
 {
+    if (argc < 5)
+    {
+        SDL_Log("Usage: %s --headless <mesh.obj> <camera path> <output dir> [--png] [--size WxH] [--lod]", argv[0]);
+        return 1;
+    }
+
+    std::string mesh_file {argv[2]};
+    std::string path_file {argv[3]};
+    std::filesystem::path out_dir {argv[4]};
+
+    ImageFormat format {ImageFormat::PPM};
+    int width {RAST::SCREEN_WIDTH};
+    int height {RAST::SCREEN_HEIGHT};
+    bool lods {false};
+
+    for (int i = 5; i < argc; ++i)
+    {
+        std::string arg {argv[i]};
+        if (arg == "--png")
+        {
+            format = ImageFormat::PNG;
+        }
+        else if (arg == "--lod")
+        {
+            lods = true;
+        }
+        else if (arg == "--size" && i + 1 < argc && std::sscanf(argv[i + 1], "%dx%d", &width, &height) == 2 && width > 0 && height > 0)
+        {
+            ++i;
+        }
+        else
+        {
+            SDL_Log("Unknown or malformed option: %s", argv[i]);
+            return 1;
+        }
+    }
+
+    try
+    {
+        CachedMesh mesh {loadCachedMesh(mesh_file, ObjParseMode::Parallel, true, lods)};
+        CameraPath path {loadCameraPath(path_file)};
+        std::filesystem::create_directories(out_dir);
+
+        Camera camera (
+            Vector3(0,0,0),
+            80.0f,
+            width/(float)height
+        );
+
+        Scene scene;
+        scene.add(&mesh.view(), Transform(Vector3(0, 0, 0), Vector3(1, 1, 1), Quaternion(1, 0, 0, 0)));
+
+        Renderer headless(width, height, &camera);
+        std::vector<uint8_t> image_scratch;
+        char name[32];
+
+        auto start {std::chrono::steady_clock::now()};
+
+        for (int frame = 0; frame < path.frameCount(); ++frame)
+        {
+            path.apply(frame, camera);
+
+            headless.BeginFrame();
+            headless.RenderScene(scene);
+            headless.EndFrame();
+
+            std::snprintf(name, sizeof(name), "frame_%05d.%s", frame, imageExtension(format));
+            writeImage((out_dir / name).string(), headless.framebuffer(), format, image_scratch);
+        }
+
+        double seconds {std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count()};
+        SDL_Log("Rendered %d frames in %.2f s (%.0f frames/minute)",
+            path.frameCount(), seconds, path.frameCount() / seconds * 60.0);
+    }
+    catch (const std::exception& e)
+    {
+        SDL_Log("Headless render failed: %s", e.what());
+        return 1;
+    }
+
+    return 0;
+}
+
+int main(int argc, char* argv[])
+{
+    profileSetThreadName("main");
+
+    if (argc > 1 && std::string(argv[1]) == "--headless")
+    {
+        return runHeadless(argc, argv);
+    }
+
     SDL_Window* window {nullptr};
     SDL_Renderer* renderer {nullptr};
 
@@ -36,44 +142,194 @@ int main()
         RAST::SCREEN_WIDTH/(float)RAST::SCREEN_HEIGHT
     );
 
-    Mesh mesh {getMeshFromObj("OBJ format/grenade-b.obj")};
-    Renderable renderable{
-        &mesh, 
+    // Loads finish in the background and wake the loop through this event
+    Uint32 frame_event {SDL_RegisterEvents(2)};
+    Uint32 mesh_event {frame_event + 1};
+
+    MeshLoader loader(0, [mesh_event] {
+        SDL_Event loaded {};
+        loaded.type = mesh_event;
+        SDL_PushEvent(&loaded);
+    });
+
+    // Objects show a placeholder box until their mesh is swapped in
+    struct PendingMesh
+    {
+        ObjectId object;
+        MeshHandle mesh;
+    };
+    std::vector<PendingMesh> pending_meshes;
+    std::vector<MeshHandle> loaded_meshes;
+
+    Scene scene;
+    ObjectId grenade {scene.add(
+        AABB{Vector3(-1, -1, -1), Vector3(1, 1, 1)},
         Transform(
             Vector3(5, 0, 2),
             Vector3(2, 2, 2),
             fromAxisAngle(Vector3(1, 2, 3), 60)
         )
-    };
+    )};
 
-    Renderer m_renderer(window, renderer, &camera);
+    pending_meshes.push_back(PendingMesh{grenade, loader.request("OBJ format/grenade-b.obj", ObjParseMode::Serial, true, true)});
+
+    // The render thread draws replicas, brought up to date from snapshots;
+    // the object set is fixed from here on, only transforms and meshes change
+    Camera render_camera {camera};
+    Scene render_scene {scene};
+
+    // Released before close() so its frame texture goes before the SDL renderer
+    auto m_renderer {std::make_unique<Renderer>(window, renderer, &render_camera, RenderBackend::Software)};
+
+    TripleBuffer<SceneSnapshot> snapshots;
+
+    // Renders the newest snapshot while the main thread handles input and
+    // presents; SDL's window and renderer calls stay on the main thread
+    std::thread render_thread([&] {
+        profileSetThreadName("render");
+        bool stats_reported {false};
+        uint64_t seen {0};
+
+        while (true)
+        {
+            seen = snapshots.wait(seen);
+            if (snapshots.closed()) return;
+            if (!snapshots.acquire()) continue;
+
+            applySnapshot(snapshots.front(), render_camera, render_scene);
+
+            m_renderer->BeginFrame();
+            m_renderer->RenderScene(render_scene);
+
+            if (!stats_reported)
+            {
+                const RenderStats& stats {m_renderer->stats()};
+                SDL_Log("Vertex cache: %zu vertices transformed for %zu indices (ratio %.3f)",
+                    stats.vertices_transformed, stats.indices_processed, stats.transformRatio());
+                SDL_Log("Vertex transform kernel: %s", simdLevelName(simdLevel()));
+                stats_reported = true;
+            }
+
+            m_renderer->FinishFrame();
+
+            SDL_Event done {};
+            done.type = frame_event;
+            SDL_PushEvent(&done);
+        }
+    });
+
+    CameraState published_camera {};
+    uint64_t published_revision {0};
+    bool force_publish {true};
 
     while (running)
     {
+        bool present_pending {false};
+
         while(SDL_PollEvent(&e))
         {
             if (e.type == SDL_EVENT_QUIT)
             {
                 running = false;
             }
+            else if (e.type == SDL_EVENT_KEY_DOWN && !e.key.repeat)
+            {
+                // F1 toggles the profiler overlay, F2 captures a trace
+                if (e.key.scancode == SDL_SCANCODE_F1)
+                {
+                    m_renderer->setProfileOverlay(!m_renderer->profileOverlay());
+                    force_publish = true;
+                }
+                else if (e.key.scancode == SDL_SCANCODE_F2)
+                {
+                    profileStartCapture(120, "rasterizer_trace.json");
+                }
+            }
+            else if (e.type == SDL_EVENT_WINDOW_EXPOSED)
+            {
+                present_pending = true;
+            }
+            else if (e.type == frame_event)
+            {
+                present_pending = true;
+            }
         }
 
+        if (!running) break;
+
         const bool *keyStates = SDL_GetKeyboardState(nullptr);
 
         if (keyStates[SDL_SCANCODE_B])
         {
             Quaternion yawQ {fromAxisAngle(Vector3(0, 1, 0), .5f)};
-            renderable.transform.rotation = (renderable.transform.rotation * yawQ).normalize();
+            Transform t {scene.transform(grenade)};
+            t.rotation = (t.rotation * yawQ).normalize();
+            scene.setTransform(grenade, t);
         }
         takeInput(keyStates, camera);
 
-        SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
-        SDL_RenderClear(renderer);
+        loaded_meshes.clear();
+        loader.poll(loaded_meshes);
+        for (MeshHandle handle : loaded_meshes)
+        {
+            // Failed loads were logged by the loader and keep their placeholder
+            const MeshView* view {loader.view(handle)};
+            if (view == nullptr) continue;
 
-        m_renderer.RenderObject(renderable);
+            if (view->lods != nullptr)
+            {
+                for (size_t i = 0; i < view->lods->levels.size(); ++i)
+                {
+                    const LODLevel& level {view->lods->levels[i]};
+                    SDL_Log("%s LOD %zu: %zu triangles, error %.5f",
+                        loader.filename(handle).c_str(), i, level.mesh.index_count / 3, level.error);
+                }
+            }
 
-        SDL_RenderPresent(renderer);
+            for (const PendingMesh& p : pending_meshes)
+            {
+                if (p.mesh == handle) scene.setMesh(p.object, view);
+            }
+        }
+
+        // A running trace capture needs frames even when nothing moves
+        bool changed {
+            force_publish ||
+            profileCapturing() ||
+            scene.revision() != published_revision ||
+            !(camera.state() == published_camera)
+        };
+
+        if (changed)
+        {
+            captureSnapshot(camera, scene, snapshots.back());
+            snapshots.publish();
+
+            published_camera = camera.state();
+            published_revision = scene.revision();
+            force_publish = false;
+        }
+
+        if (present_pending)
+        {
+            // Blocks on vsync, which paces the update loop while frames arrive
+            m_renderer->Present();
+        }
+        else if (!changed)
+        {
+            // Nothing moved: sleep until the next event instead of spinning
+            SDL_WaitEvent(nullptr);
+        }
+        else
+        {
+            // Input keeps updating at display rate while the render thread works
+            SDL_WaitEventTimeout(nullptr, 16);
+        }
     }
 
+    snapshots.close();
+    render_thread.join();
+
+    m_renderer.reset();
     close(window, renderer);
 }
\ No newline at end of file
@@ -0,0 +1,59 @@
+#include "../include/arena.hpp"
+
+#include <algorithm>
+
+FrameArena::FrameArena(size_t capacity)
+: m_block(capacity), m_capacity(capacity)
+{
+}
+
+void* FrameArena::allocate(size_t size, size_t alignment)
+{
+    std::byte* base {m_block.data()};
+    size_t offset {m_offset.load(std::memory_order_relaxed)};
+    size_t start;
+    size_t end;
+
+    do
+    {
+        // The block is cache-line aligned, so aligning the offset aligns the pointer
+        start = (offset + alignment - 1) & ~(alignment - 1);
+        end = start + size;
+        if (end > m_capacity) return spill(size, alignment);
+    }
+    while (!m_offset.compare_exchange_weak(offset, end, std::memory_order_relaxed));
+
+    return base + start;
+}
+
+void* FrameArena::spill(size_t size, size_t alignment)
+{
+    std::lock_guard<std::mutex> lock {m_spill_mutex};
+
+    // Spill blocks share the cache-line alignment of the main block
+    m_spills.emplace_back(std::max(size, alignment));
+    m_spill_bytes += size;
+    return m_spills.back().data();
+}
+
+size_t FrameArena::used() const
+{
+    return m_offset.load(std::memory_order_relaxed) + m_spill_bytes;
+}
+
+void FrameArena::reset()
+{
+    if (!m_spills.empty())
+    {
+        // One block for the whole of that frame, with headroom so a
+        // slightly bigger one does not spill again
+        size_t needed {used()};
+        m_capacity = std::max(m_capacity * 2, needed + needed / 2);
+        m_block = AlignedVector<std::byte>(m_capacity);
+
+        m_spills.clear();
+        m_spill_bytes = 0;
+    }
+
+    m_offset.store(0, std::memory_order_relaxed);
+}
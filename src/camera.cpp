@@ -1,5 +1,47 @@
 #include "../include/camera.hpp"
 
+#include <algorithm>
+
+bool operator==(const CameraState& a, const CameraState& b)
+{
+    return (
+        a.position.v == b.position.v &&
+        a.orientation.w() == b.orientation.w() && a.orientation.x() == b.orientation.x() &&
+        a.orientation.y() == b.orientation.y() && a.orientation.z() == b.orientation.z() &&
+        a.fov == b.fov && a.aspect_ratio == b.aspect_ratio &&
+        a.near_plane == b.near_plane && a.far_plane == b.far_plane
+    );
+}
+
+CameraState Camera::state() const
+{
+    return CameraState{position, orientation, fov, aspect_ratio, near_plane, far_plane};
+}
+
+void Camera::setState(const CameraState& s)
+{
+    position = s.position;
+    orientation = s.orientation;
+    fov = s.fov;
+    aspect_ratio = s.aspect_ratio;
+    near_plane = s.near_plane;
+    far_plane = s.far_plane;
+}
+
+Matrix4x4 perspectiveMatrix(float fov, float aspect_ratio, float near_plane, float far_plane)
+{
+    float f {1.0f / std::tan(fov * 0.5f * PI / 180.0f)};
+    float range {far_plane / (far_plane - near_plane)};
+
+    Matrix4x4 p {};
+    p.m[0][0] = -f / aspect_ratio;
+    p.m[1][1] = -f;
+    p.m[2][2] = -range;
+    p.m[2][3] = -range * near_plane;
+    p.m[3][2] = -1.0f;
+    return p;
+}
+
 Matrix4x4 Camera::viewMatrix()
 {
     Vector3 forward {rotate({0, 0, 1}, orientation)};
@@ -23,6 +65,86 @@ Matrix4x4 Camera::viewMatrix()
     return rotation.MatMult(translation);
 }
 
+Frustum Camera::frustumPlanes()
+{
+    Vector3 forward {rotate({0, 0, 1}, orientation)};
+    Vector3 up {rotate({0, 1, 0}, orientation)};
+    Vector3 right {forward.cross(up)};
+
+    float tan_v {std::tan(fov * 0.5f * PI / 180.0f)};
+    float tan_h {tan_v * aspect_ratio};
+
+    auto plane = [&](Vector3 normal) {
+        Vector3 n {normal.unit()};
+        return Plane{n, -dot(n, position)};
+    };
+
+    Plane near_side {forward, -dot(forward, position) - near_plane};
+    Plane far_side {-forward, dot(forward, position) + far_plane};
+
+    return Frustum{
+        near_side,
+        far_side,
+        plane(right + forward * tan_h),
+        plane(forward * tan_h - right),
+        plane(up + forward * tan_v),
+        plane(forward * tan_v - up)
+    };
+}
+
+bool isVisible(const Bounds& b, const Matrix4x4& model, const Frustum& frustum)
+{
+    const auto& m {model.m};
+
+    // Sphere: centre through the model matrix, radius by its largest axis scale
+    const Vector3& c {b.sphere.center};
+    Vector3 center {
+        m[0][0] * c.x() + m[0][1] * c.y() + m[0][2] * c.z() + m[0][3],
+        m[1][0] * c.x() + m[1][1] * c.y() + m[1][2] * c.z() + m[1][3],
+        m[2][0] * c.x() + m[2][1] * c.y() + m[2][2] * c.z() + m[2][3]
+    };
+
+    float scale_squared {0.0f};
+    for (int j = 0; j < 3; ++j)
+    {
+        Vector3 axis {m[0][j], m[1][j], m[2][j]};
+        scale_squared = std::max(scale_squared, dot(axis, axis));
+    }
+    float radius {b.sphere.radius * std::sqrt(scale_squared)};
+
+    for (const Plane& p : frustum)
+    {
+        if (dot(p.normal, center) + p.d < -radius) return false;
+    }
+
+    return classify(transformAABB(b.box, model), frustum) != Containment::Outside;
+}
+
+Containment classify(const AABB& box, const Frustum& frustum)
+{
+    Vector3 box_min {box.min};
+    Vector3 box_max {box.max};
+    Vector3 center {(box_min + box_max) * 0.5f};
+    Vector3 extent {(box_max - box_min) * 0.5f};
+
+    Containment result {Containment::Inside};
+
+    for (const Plane& p : frustum)
+    {
+        float reach {
+            std::abs(p.normal.x()) * extent.x() +
+            std::abs(p.normal.y()) * extent.y() +
+            std::abs(p.normal.z()) * extent.z()
+        };
+        float distance {dot(p.normal, center) + p.d};
+
+        if (distance < -reach) return Containment::Outside;
+        if (distance < reach) result = Containment::Intersecting;
+    }
+
+    return result;
+}
+
 PointNDC Camera::getNDC(Vertex point)
 {
     // Camera transform
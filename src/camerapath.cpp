@@ -0,0 +1,92 @@
+#include "../include/camerapath.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+CameraPath::CameraPath(std::vector<CameraKey> keys)
+: m_keys(std::move(keys))
+{
+    if (m_keys.empty())
+    {
+        throw std::runtime_error("camera path has no keys.");
+    }
+
+    std::stable_sort(m_keys.begin(), m_keys.end(), [](const CameraKey& a, const CameraKey& b) {
+        return a.frame < b.frame;
+    });
+}
+
+int CameraPath::frameCount() const
+{
+    return m_keys.back().frame + 1;
+}
+
+void CameraPath::apply(int frame, Camera& camera) const
+{
+    // First key at or after the frame; frames outside the path hold the end keys
+    auto next {std::lower_bound(m_keys.begin(), m_keys.end(), frame, [](const CameraKey& k, int f) {
+        return k.frame < f;
+    })};
+
+    CameraKey key {};
+    if (next == m_keys.begin())
+    {
+        key = m_keys.front();
+    }
+    else if (next == m_keys.end())
+    {
+        key = m_keys.back();
+    }
+    else
+    {
+        const CameraKey& a {*(next - 1)};
+        const CameraKey& b {*next};
+        float t {(float)(frame - a.frame) / (float)(b.frame - a.frame)};
+
+        Vector3 a_pos {a.position};
+        Vector3 b_pos {b.position};
+        key.position = a_pos + (b_pos - a_pos) * t;
+        key.yaw = a.yaw + (b.yaw - a.yaw) * t;
+        key.pitch = a.pitch + (b.pitch - a.pitch) * t;
+    }
+
+    camera.position = key.position;
+    camera.orientation = (fromAxisAngle(Vector3(0, 1, 0), key.yaw) * fromAxisAngle(Vector3(1, 0, 0), key.pitch)).normalize();
+}
+
+CameraPath loadCameraPath(const std::string& filename)
+{
+    std::ifstream file {filename};
+    if (!file)
+    {
+        throw std::runtime_error("file " + filename + " not found.");
+    }
+
+    std::vector<CameraKey> keys;
+    std::string line;
+    int line_number {0};
+
+    while (std::getline(file, line))
+    {
+        ++line_number;
+
+        size_t start {line.find_first_not_of(" \t\r")};
+        if (start == std::string::npos || line[start] == '#') continue;
+
+        std::istringstream fields {line};
+        CameraKey key {};
+        float x, y, z;
+
+        if (!(fields >> key.frame >> x >> y >> z >> key.yaw >> key.pitch) || key.frame < 0)
+        {
+            throw std::runtime_error(filename + ":" + std::to_string(line_number) + ": malformed camera key.");
+        }
+
+        key.position = Vector3(x, y, z);
+        keys.push_back(key);
+    }
+
+    return CameraPath(std::move(keys));
+}
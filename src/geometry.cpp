@@ -1,5 +1,7 @@
 #include "../include/geometry.hpp"
 
+#include <algorithm>
+
 Matrix4x4 Transform::translationMatrix() const
 {
     return Matrix4x4{
@@ -26,7 +28,7 @@ Matrix4x4 Transform::rotationMatrix() const
 
     return Matrix4x4{
         {1 - 2 * (y * y + z * z), 2 * (x * y - w * z), 2 * (x * z + w * y), 0},
-        {2 * (x * y + w * z), 1 - 2 * (x * x  + z * z), 2 * (y * z - 2 * x), 0},
+        {2 * (x * y + w * z), 1 - 2 * (x * x  + z * z), 2 * (y * z - w * x), 0},
         {2 * (x * z - w * y), 2 * (y * z + w * x), 1 - 2 * (x * x + y * y), 0},
         {0, 0, 0, 1},
     };
@@ -35,4 +37,138 @@ Matrix4x4 Transform::rotationMatrix() const
 Matrix4x4 Transform::transformMatrix() const
 {
     return translationMatrix().MatMult(rotationMatrix()).MatMult(scaleMatrix());
+}
+
+Mesh boxMesh(const AABB& box, const ColorRGB& color)
+{
+    Mesh mesh;
+
+    // Corner k takes max on axis i when bit i of k is set
+    for (uint32_t k = 0; k < 8; ++k)
+    {
+        mesh.vertices.push_back(Vertex{
+            {
+                (k & 1) ? box.max.x() : box.min.x(),
+                (k & 2) ? box.max.y() : box.min.y(),
+                (k & 4) ? box.max.z() : box.min.z()
+            },
+            color
+        });
+    }
+
+    mesh.indices = {
+        0, 2, 3, 0, 3, 1,
+        4, 5, 7, 4, 7, 6,
+        0, 1, 5, 0, 5, 4,
+        2, 6, 7, 2, 7, 3,
+        0, 4, 6, 0, 6, 2,
+        1, 3, 7, 1, 7, 5
+    };
+
+    mesh.bounds = computeBounds(mesh.vertices.data(), mesh.vertices.size());
+    return mesh;
+}
+
+MeshSoA toSoA(const Mesh& m)
+{
+    MeshSoA soa;
+    size_t n {m.vertices.size()};
+
+    soa.x.resize(n);
+    soa.y.resize(n);
+    soa.z.resize(n);
+    soa.r.resize(n);
+    soa.g.resize(n);
+    soa.b.resize(n);
+    soa.u.resize(n);
+    soa.v.resize(n);
+
+    for (size_t i = 0; i < n; ++i)
+    {
+        const Vertex& v {m.vertices[i]};
+
+        soa.x[i] = v.pos.x();
+        soa.y[i] = v.pos.y();
+        soa.z[i] = v.pos.z();
+
+        soa.r[i] = v.color.r();
+        soa.g[i] = v.color.g();
+        soa.b[i] = v.color.b();
+
+        soa.u[i] = v.uv.x();
+        soa.v[i] = v.uv.y();
+    }
+
+    soa.indices = m.indices;
+    soa.bounds = m.bounds;
+    soa.texture = m.texture;
+
+    return soa;
+}
+
+Bounds computeBounds(const Vertex* vertices, size_t count)
+{
+    if (count == 0) return Bounds{};
+
+    Vector3 lo {vertices[0].pos};
+    Vector3 hi {vertices[0].pos};
+
+    for (size_t i = 1; i < count; ++i)
+    {
+        const Vector3& p {vertices[i].pos};
+        for (int k = 0; k < 3; ++k)
+        {
+            lo.v[k] = std::min(lo.v[k], p.v[k]);
+            hi.v[k] = std::max(hi.v[k], p.v[k]);
+        }
+    }
+
+    // Sphere around the box centre, as tight as the points allow
+    Vector3 center {(lo + hi) * 0.5f};
+    float radius_squared {0.0f};
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        Vector3 p {vertices[i].pos};
+        Vector3 d {p - center};
+        radius_squared = std::max(radius_squared, dot(d, d));
+    }
+
+    return Bounds{{lo, hi}, {center, std::sqrt(radius_squared)}};
+}
+
+AABB transformAABB(const AABB& box, const Matrix4x4& matrix)
+{
+    const auto& m {matrix.m};
+
+    Vector3 box_min {box.min};
+    Vector3 box_max {box.max};
+    Vector3 local_center {(box_min + box_max) * 0.5f};
+    Vector3 local_extent {(box_max - box_min) * 0.5f};
+
+    Vector3 center;
+    Vector3 extent;
+    for (int i = 0; i < 3; ++i)
+    {
+        center.v[i] = m[i][3];
+        extent.v[i] = 0.0f;
+        for (int j = 0; j < 3; ++j)
+        {
+            center.v[i] += m[i][j] * local_center.v[j];
+            extent.v[i] += std::abs(m[i][j]) * local_extent.v[j];
+        }
+    }
+
+    return AABB{center - extent, center + extent};
+}
+
+AABB mergeAABB(const AABB& a, const AABB& b)
+{
+    AABB result;
+    for (int k = 0; k < 3; ++k)
+    {
+        result.min.v[k] = std::min(a.min.v[k], b.min.v[k]);
+        result.max.v[k] = std::max(a.max.v[k], b.max.v[k]);
+    }
+    return result;
 }
\ No newline at end of file
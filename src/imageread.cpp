@@ -0,0 +1,469 @@
+#include "../include/imageread.hpp"
+#include "../include/mappedfile.hpp"
+
+#include <array>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+
+static uint32_t loadBE32(const uint8_t* in)
+{
+    return (uint32_t)in[0] << 24 | (uint32_t)in[1] << 16 | (uint32_t)in[2] << 8 | (uint32_t)in[3];
+}
+
+// Deflate reads bits least significant first
+class BitReader
+{
+    public:
+    BitReader(const uint8_t* data, size_t size)
+    : m_data(data), m_size(size) {}
+
+    uint32_t bits(int count)
+    {
+        while (m_count < count)
+        {
+            if (m_pos >= m_size)
+            {
+                throw std::runtime_error("truncated image data.");
+            }
+            m_buffer |= (uint32_t)m_data[m_pos++] << m_count;
+            m_count += 8;
+        }
+
+        uint32_t value {m_buffer & ((1u << count) - 1)};
+        m_buffer >>= count;
+        m_count -= count;
+        return value;
+    }
+
+    // Drops the rest of the current byte
+    void align()
+    {
+        m_buffer = 0;
+        m_count = 0;
+    }
+
+    const uint8_t* bytes(size_t count)
+    {
+        if (m_size - m_pos < count)
+        {
+            throw std::runtime_error("truncated image data.");
+        }
+        const uint8_t* p {m_data + m_pos};
+        m_pos += count;
+        return p;
+    }
+
+    private:
+    const uint8_t* m_data;
+    size_t m_size;
+    size_t m_pos {0};
+    uint32_t m_buffer {0};
+    int m_count {0};
+};
+
+// Canonical Huffman code as counts per length and symbols in code order
+struct Huffman
+{
+    std::array<uint16_t, 16> count {};
+    std::array<uint16_t, 288> symbol {};
+
+    void build(const uint8_t* lengths, int n)
+    {
+        count.fill(0);
+        for (int s = 0; s < n; ++s) ++count[lengths[s]];
+        count[0] = 0;
+
+        int left {1};
+        for (int length = 1; length < 16; ++length)
+        {
+            left = left * 2 - count[length];
+            if (left < 0)
+            {
+                throw std::runtime_error("invalid Huffman code.");
+            }
+        }
+
+        std::array<uint16_t, 16> offset {};
+        for (int length = 1; length < 15; ++length)
+        {
+            offset[length + 1] = offset[length] + count[length];
+        }
+        for (int s = 0; s < n; ++s)
+        {
+            if (lengths[s] != 0) symbol[offset[lengths[s]]++] = (uint16_t)s;
+        }
+    }
+
+    int decode(BitReader& in) const
+    {
+        // First code and first symbol index of each length, walked one bit at a time
+        int code {0};
+        int first {0};
+        int index {0};
+
+        for (int length = 1; length < 16; ++length)
+        {
+            code |= (int)in.bits(1);
+            int n {count[length]};
+            if (code - n < first) return symbol[index + (code - first)];
+
+            index += n;
+            first = (first + n) << 1;
+            code <<= 1;
+        }
+
+        throw std::runtime_error("invalid Huffman code.");
+    }
+};
+
+static constexpr uint16_t LENGTH_BASE[29] {
+    3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+    35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+};
+static constexpr uint8_t LENGTH_EXTRA[29] {
+    0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+    3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+};
+static constexpr uint16_t DISTANCE_BASE[30] {
+    1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+    257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577
+};
+static constexpr uint8_t DISTANCE_EXTRA[30] {
+    0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+    7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+};
+
+static void inflateBlock(BitReader& in, const Huffman& literals, const Huffman& distances, std::vector<uint8_t>& out)
+{
+    while (true)
+    {
+        int symbol {literals.decode(in)};
+        if (symbol < 256)
+        {
+            out.push_back((uint8_t)symbol);
+            continue;
+        }
+        if (symbol == 256) return;
+
+        symbol -= 257;
+        if (symbol >= 29)
+        {
+            throw std::runtime_error("invalid deflate length.");
+        }
+        size_t length {LENGTH_BASE[symbol] + in.bits(LENGTH_EXTRA[symbol])};
+
+        int d {distances.decode(in)};
+        if (d >= 30)
+        {
+            throw std::runtime_error("invalid deflate distance.");
+        }
+        size_t distance {DISTANCE_BASE[d] + in.bits(DISTANCE_EXTRA[d])};
+        if (distance > out.size())
+        {
+            throw std::runtime_error("invalid deflate distance.");
+        }
+
+        // Byte by byte: the copy may overlap the bytes it produces
+        size_t from {out.size() - distance};
+        for (size_t i = 0; i < length; ++i)
+        {
+            out.push_back(out[from + i]);
+        }
+    }
+}
+
+static void readDynamicCodes(BitReader& in, Huffman& literals, Huffman& distances)
+{
+    static constexpr uint8_t ORDER[19] {16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15};
+
+    int literal_count {(int)in.bits(5) + 257};
+    int distance_count {(int)in.bits(5) + 1};
+    int code_count {(int)in.bits(4) + 4};
+    if (literal_count > 286 || distance_count > 30)
+    {
+        throw std::runtime_error("invalid deflate code counts.");
+    }
+
+    uint8_t lengths[286 + 30] {};
+    for (int i = 0; i < code_count; ++i)
+    {
+        lengths[ORDER[i]] = (uint8_t)in.bits(3);
+    }
+
+    Huffman code_lengths;
+    code_lengths.build(lengths, 19);
+
+    // Literal and distance lengths form one run-length coded sequence
+    int total {literal_count + distance_count};
+    std::memset(lengths, 0, sizeof(lengths));
+    int i {0};
+    while (i < total)
+    {
+        int symbol {code_lengths.decode(in)};
+        if (symbol < 16)
+        {
+            lengths[i++] = (uint8_t)symbol;
+            continue;
+        }
+
+        uint8_t value {0};
+        int repeat;
+        if (symbol == 16)
+        {
+            if (i == 0)
+            {
+                throw std::runtime_error("invalid deflate code lengths.");
+            }
+            value = lengths[i - 1];
+            repeat = 3 + (int)in.bits(2);
+        }
+        else if (symbol == 17)
+        {
+            repeat = 3 + (int)in.bits(3);
+        }
+        else
+        {
+            repeat = 11 + (int)in.bits(7);
+        }
+
+        if (i + repeat > total)
+        {
+            throw std::runtime_error("invalid deflate code lengths.");
+        }
+        while (repeat-- > 0) lengths[i++] = value;
+    }
+
+    literals.build(lengths, literal_count);
+    distances.build(lengths + literal_count, distance_count);
+}
+
+// zlib stream to raw bytes; the Adler-32 trailer is not checked
+static void inflateZlib(const uint8_t* data, size_t size, std::vector<uint8_t>& out)
+{
+    if (size < 2 || (data[0] & 0x0F) != 8 || ((data[0] << 8) | data[1]) % 31 != 0 || (data[1] & 0x20))
+    {
+        throw std::runtime_error("unsupported zlib stream.");
+    }
+
+    BitReader in(data + 2, size - 2);
+    bool last {false};
+
+    while (!last)
+    {
+        last = in.bits(1) != 0;
+        uint32_t type {in.bits(2)};
+
+        if (type == 0)
+        {
+            in.align();
+            const uint8_t* header {in.bytes(4)};
+            uint32_t length {(uint32_t)header[0] | (uint32_t)header[1] << 8};
+            uint32_t inverse {(uint32_t)header[2] | (uint32_t)header[3] << 8};
+            if (length != (~inverse & 0xFFFF))
+            {
+                throw std::runtime_error("invalid stored block.");
+            }
+
+            const uint8_t* bytes {in.bytes(length)};
+            out.insert(out.end(), bytes, bytes + length);
+        }
+        else if (type == 1)
+        {
+            // Fixed codes, built once
+            static const std::array<Huffman, 2> fixed {[] {
+                uint8_t lengths[288];
+                std::memset(lengths + 0, 8, 144);
+                std::memset(lengths + 144, 9, 112);
+                std::memset(lengths + 256, 7, 24);
+                std::memset(lengths + 280, 8, 8);
+
+                std::array<Huffman, 2> codes;
+                codes[0].build(lengths, 288);
+                std::memset(lengths, 5, 30);
+                codes[1].build(lengths, 30);
+                return codes;
+            }()};
+
+            inflateBlock(in, fixed[0], fixed[1], out);
+        }
+        else if (type == 2)
+        {
+            Huffman literals;
+            Huffman distances;
+            readDynamicCodes(in, literals, distances);
+            inflateBlock(in, literals, distances, out);
+        }
+        else
+        {
+            throw std::runtime_error("invalid deflate block.");
+        }
+    }
+}
+
+static uint8_t paeth(int a, int b, int c)
+{
+    int p {a + b - c};
+    int pa {std::abs(p - a)};
+    int pb {std::abs(p - b)};
+    int pc {std::abs(p - c)};
+
+    if (pa <= pb && pa <= pc) return (uint8_t)a;
+    if (pb <= pc) return (uint8_t)b;
+    return (uint8_t)c;
+}
+
+// Reverses the per-row filters in place; rows keep their filter byte
+static void unfilter(uint8_t* data, size_t rows, size_t row_bytes, size_t pixel_bytes)
+{
+    const uint8_t* previous {nullptr};
+
+    for (size_t y = 0; y < rows; ++y)
+    {
+        uint8_t filter {data[0]};
+        uint8_t* row {data + 1};
+
+        for (size_t i = 0; i < row_bytes; ++i)
+        {
+            int left {i >= pixel_bytes ? row[i - pixel_bytes] : 0};
+            int up {previous ? previous[i] : 0};
+            int up_left {previous && i >= pixel_bytes ? previous[i - pixel_bytes] : 0};
+
+            switch (filter)
+            {
+                case 0: break;
+                case 1: row[i] = (uint8_t)(row[i] + left); break;
+                case 2: row[i] = (uint8_t)(row[i] + up); break;
+                case 3: row[i] = (uint8_t)(row[i] + (left + up) / 2); break;
+                case 4: row[i] = (uint8_t)(row[i] + paeth(left, up, up_left)); break;
+                default: throw std::runtime_error("invalid PNG filter.");
+            }
+        }
+
+        previous = row;
+        data += row_bytes + 1;
+    }
+}
+
+Image readImage(const std::string& filename)
+{
+    static const uint8_t signature[8] {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+
+    MappedFile file(filename);
+    const uint8_t* p {reinterpret_cast<const uint8_t*>(file.data())};
+    const uint8_t* end {p + file.size()};
+
+    if (file.size() < 8 || std::memcmp(p, signature, 8) != 0)
+    {
+        throw std::runtime_error(filename + ": not a PNG file.");
+    }
+    p += 8;
+
+    Image image;
+    int color_type {-1};
+    std::vector<uint8_t> compressed;
+    std::array<uint32_t, 256> palette {};
+
+    try
+    {
+        while (true)
+        {
+            if (end - p < 12)
+            {
+                throw std::runtime_error("truncated chunk.");
+            }
+
+            uint32_t length {loadBE32(p)};
+            const uint8_t* type {p + 4};
+            const uint8_t* data {p + 8};
+            if ((size_t)(end - data) < (size_t)length + 4)
+            {
+                throw std::runtime_error("truncated chunk.");
+            }
+            p = data + length + 4;
+
+            if (std::memcmp(type, "IHDR", 4) == 0 && length == 13)
+            {
+                image.width = (int)loadBE32(data);
+                image.height = (int)loadBE32(data + 4);
+                color_type = data[9];
+
+                bool supported_type {color_type == 0 || color_type == 2 || color_type == 3 || color_type == 4 || color_type == 6};
+                if (data[8] != 8 || !supported_type || data[12] != 0)
+                {
+                    throw std::runtime_error("only 8-bit non-interlaced PNGs are supported.");
+                }
+                if (image.width <= 0 || image.height <= 0 || image.width > (1 << 16) || image.height > (1 << 16))
+                {
+                    throw std::runtime_error("unsupported image size.");
+                }
+            }
+            else if (std::memcmp(type, "PLTE", 4) == 0)
+            {
+                for (uint32_t i = 0; i < length / 3 && i < 256; ++i)
+                {
+                    palette[i] = 0xFF000000u | (uint32_t)data[i * 3] << 16 | (uint32_t)data[i * 3 + 1] << 8 | data[i * 3 + 2];
+                }
+            }
+            else if (std::memcmp(type, "tRNS", 4) == 0 && color_type == 3)
+            {
+                for (uint32_t i = 0; i < length && i < 256; ++i)
+                {
+                    palette[i] = (palette[i] & 0x00FFFFFFu) | (uint32_t)data[i] << 24;
+                }
+            }
+            else if (std::memcmp(type, "IDAT", 4) == 0)
+            {
+                compressed.insert(compressed.end(), data, data + length);
+            }
+            else if (std::memcmp(type, "IEND", 4) == 0)
+            {
+                break;
+            }
+        }
+
+        if (color_type < 0)
+        {
+            throw std::runtime_error("missing IHDR chunk.");
+        }
+
+        static constexpr size_t channels_of[7] {1, 0, 3, 1, 2, 0, 4};
+        size_t channels {channels_of[color_type]};
+        size_t row_bytes {(size_t)image.width * channels};
+
+        std::vector<uint8_t> raw;
+        raw.reserve((row_bytes + 1) * image.height);
+        inflateZlib(compressed.data(), compressed.size(), raw);
+        if (raw.size() < (row_bytes + 1) * image.height)
+        {
+            throw std::runtime_error("truncated image data.");
+        }
+
+        unfilter(raw.data(), image.height, row_bytes, channels);
+
+        image.pixels.resize((size_t)image.width * image.height);
+        for (int y = 0; y < image.height; ++y)
+        {
+            const uint8_t* src {raw.data() + (size_t)y * (row_bytes + 1) + 1};
+            uint32_t* dst {image.pixels.data() + (size_t)y * image.width};
+
+            for (int x = 0; x < image.width; ++x, src += channels)
+            {
+                switch (color_type)
+                {
+                    case 0: dst[x] = 0xFF000000u | src[0] * 0x010101u; break;
+                    case 2: dst[x] = 0xFF000000u | (uint32_t)src[0] << 16 | (uint32_t)src[1] << 8 | src[2]; break;
+                    case 3: dst[x] = palette[src[0]]; break;
+                    case 4: dst[x] = (uint32_t)src[1] << 24 | src[0] * 0x010101u; break;
+                    default: dst[x] = (uint32_t)src[3] << 24 | (uint32_t)src[0] << 16 | (uint32_t)src[1] << 8 | src[2]; break;
+                }
+            }
+        }
+    }
+    catch (const std::runtime_error& e)
+    {
+        throw std::runtime_error(filename + ": " + e.what());
+    }
+
+    return image;
+}
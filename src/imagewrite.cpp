@@ -0,0 +1,204 @@
+#include "../include/imagewrite.hpp"
+
+#include <array>
+#include <cstdio>
+#include <stdexcept>
+
+// Stored (uncompressed) deflate blocks hold at most this many bytes
+static constexpr size_t DEFLATE_BLOCK_MAX {65535};
+
+static const std::array<uint32_t, 256>& crcTable()
+{
+    static const std::array<uint32_t, 256> table {[] {
+        std::array<uint32_t, 256> t {};
+        for (uint32_t n = 0; n < 256; ++n)
+        {
+            uint32_t c {n};
+            for (int k = 0; k < 8; ++k)
+            {
+                c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            }
+            t[n] = c;
+        }
+        return t;
+    }()};
+    return table;
+}
+
+static uint32_t crc32(uint32_t crc, const uint8_t* data, size_t size)
+{
+    const std::array<uint32_t, 256>& table {crcTable()};
+
+    crc = ~crc;
+    for (size_t i = 0; i < size; ++i)
+    {
+        crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+static uint32_t adler32(const uint8_t* data, size_t size)
+{
+    uint32_t a {1};
+    uint32_t b {0};
+
+    // 5552 is the longest run before the sums can overflow 32 bits
+    while (size > 0)
+    {
+        size_t run {size < 5552 ? size : 5552};
+        size -= run;
+        for (size_t i = 0; i < run; ++i)
+        {
+            a += *data++;
+            b += a;
+        }
+        a %= 65521;
+        b %= 65521;
+    }
+    return (b << 16) | a;
+}
+
+static void storeBE32(uint8_t* out, uint32_t v)
+{
+    out[0] = (uint8_t)(v >> 24);
+    out[1] = (uint8_t)(v >> 16);
+    out[2] = (uint8_t)(v >> 8);
+    out[3] = (uint8_t)v;
+}
+
+// Writes a chunk's payload piece by piece, accumulating its CRC
+class PNGChunkWriter
+{
+    public:
+    PNGChunkWriter(std::FILE* file, const char* type, size_t size)
+    : m_file(file)
+    {
+        uint8_t length[4];
+        storeBE32(length, (uint32_t)size);
+        std::fwrite(length, 1, 4, m_file);
+        write((const uint8_t*)type, 4);
+    }
+
+    void write(const uint8_t* data, size_t size)
+    {
+        std::fwrite(data, 1, size, m_file);
+        m_crc = crc32(m_crc, data, size);
+    }
+
+    void finish()
+    {
+        uint8_t crc[4];
+        storeBE32(crc, m_crc);
+        std::fwrite(crc, 1, 4, m_file);
+    }
+
+    private:
+    std::FILE* m_file;
+    uint32_t m_crc {0};
+};
+
+// Rows of RGB, optionally prefixed with the PNG "no filter" byte
+static void packRows(const Framebuffer& fb, std::vector<uint8_t>& out, bool filter_byte)
+{
+    size_t row_size {(size_t)fb.width * 3 + (filter_byte ? 1 : 0)};
+    out.resize((size_t)fb.height * row_size);
+
+    uint8_t* dst {out.data()};
+    for (int y = 0; y < fb.height; ++y)
+    {
+        if (filter_byte) *dst++ = 0;
+
+        const uint32_t* src {fb.color.data() + (size_t)y * fb.width};
+        for (int x = 0; x < fb.width; ++x)
+        {
+            *dst++ = (uint8_t)(src[x] >> 16);
+            *dst++ = (uint8_t)(src[x] >> 8);
+            *dst++ = (uint8_t)src[x];
+        }
+    }
+}
+
+static void writePNG(std::FILE* file, const Framebuffer& fb, std::vector<uint8_t>& scratch)
+{
+    static const uint8_t signature[8] {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+    std::fwrite(signature, 1, sizeof(signature), file);
+
+    uint8_t header[13] {};
+    storeBE32(header + 0, (uint32_t)fb.width);
+    storeBE32(header + 4, (uint32_t)fb.height);
+    header[8] = 8;  // Bit depth
+    header[9] = 2;  // Truecolor RGB
+
+    PNGChunkWriter ihdr(file, "IHDR", sizeof(header));
+    ihdr.write(header, sizeof(header));
+    ihdr.finish();
+
+    packRows(fb, scratch, true);
+    size_t raw_size {scratch.size()};
+
+    // zlib stream of stored blocks: no compression, but no encoder cost either
+    size_t blocks {(raw_size + DEFLATE_BLOCK_MAX - 1) / DEFLATE_BLOCK_MAX};
+    PNGChunkWriter idat(file, "IDAT", 2 + blocks * 5 + raw_size + 4);
+
+    static const uint8_t zlib_header[2] {0x78, 0x01};
+    idat.write(zlib_header, sizeof(zlib_header));
+
+    for (size_t offset = 0; offset < raw_size; offset += DEFLATE_BLOCK_MAX)
+    {
+        size_t length {raw_size - offset < DEFLATE_BLOCK_MAX ? raw_size - offset : DEFLATE_BLOCK_MAX};
+        uint8_t block[5] {
+            (uint8_t)(offset + length == raw_size ? 1 : 0),
+            (uint8_t)length,
+            (uint8_t)(length >> 8),
+            (uint8_t)~length,
+            (uint8_t)(~length >> 8)
+        };
+        idat.write(block, sizeof(block));
+        idat.write(scratch.data() + offset, length);
+    }
+
+    uint8_t checksum[4];
+    storeBE32(checksum, adler32(scratch.data(), raw_size));
+    idat.write(checksum, sizeof(checksum));
+    idat.finish();
+
+    PNGChunkWriter iend(file, "IEND", 0);
+    iend.finish();
+}
+
+static void writePPM(std::FILE* file, const Framebuffer& fb, std::vector<uint8_t>& scratch)
+{
+    packRows(fb, scratch, false);
+
+    std::fprintf(file, "P6\n%d %d\n255\n", fb.width, fb.height);
+    std::fwrite(scratch.data(), 1, scratch.size(), file);
+}
+
+const char* imageExtension(ImageFormat format)
+{
+    return format == ImageFormat::PNG ? "png" : "ppm";
+}
+
+void writeImage(const std::string& filename, const Framebuffer& fb, ImageFormat format, std::vector<uint8_t>& scratch)
+{
+    std::FILE* file {std::fopen(filename.c_str(), "wb")};
+    if (file == nullptr)
+    {
+        throw std::runtime_error("could not create " + filename + ".");
+    }
+
+    if (format == ImageFormat::PNG)
+    {
+        writePNG(file, fb, scratch);
+    }
+    else
+    {
+        writePPM(file, fb, scratch);
+    }
+
+    bool failed {std::ferror(file) != 0};
+    if (std::fclose(file) != 0 || failed)
+    {
+        throw std::runtime_error("could not write " + filename + ".");
+    }
+}
@@ -30,6 +30,12 @@ bool init(SDL_Window*& w, SDL_Renderer*& r)
         return false;
     }
 
+    // Caps continuous redraws (camera moving) at the display rate
+    if (!SDL_SetRenderVSync(r, 1))
+    {
+        SDL_Log("Could not enable vsync! SDL error: %s\n", SDL_GetError());
+    }
+
     return true;
 }
 
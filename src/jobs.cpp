@@ -0,0 +1,292 @@
+#include "../include/jobs.hpp"
+#include "../include/profiler.hpp"
+
+#include <chrono>
+#include <limits>
+#include <string>
+
+static constexpr size_t NOT_A_WORKER {std::numeric_limits<size_t>::max()};
+
+// Queue index of this thread, and the job it is running
+static thread_local size_t t_worker {NOT_A_WORKER};
+static thread_local Job* t_current {nullptr};
+
+static uint64_t nowNs()
+{
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()
+    ).count();
+}
+
+JobSystem::JobSystem(FrameArena& arena, unsigned thread_count)
+: m_arena(arena)
+{
+    if (thread_count == 0)
+    {
+        unsigned hardware {std::thread::hardware_concurrency()};
+        thread_count = hardware > 1 ? hardware - 1 : 0;
+    }
+
+    // Queue 0 belongs to whichever thread calls run()
+    for (unsigned i = 0; i <= thread_count; ++i)
+    {
+        m_queues.push_back(std::make_unique<WorkerQueue>());
+    }
+    m_stats.resize(thread_count + 1);
+    m_report.workers.resize(thread_count + 1);
+
+    m_workers.reserve(thread_count);
+    for (unsigned i = 0; i < thread_count; ++i)
+    {
+        m_workers.emplace_back(&JobSystem::workerLoop, this, (size_t)i + 1);
+    }
+}
+
+JobSystem::~JobSystem()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_wake.notify_all();
+
+    for (auto& worker : m_workers)
+    {
+        worker.join();
+    }
+}
+
+Job* JobSystem::addJob(const char* name, void* fn, void (*invoke)(void*), void (*destroy)(void*))
+{
+    Job* job {new (m_arena.allocate(sizeof(Job), alignof(Job))) Job(m_arena)};
+    job->name = name;
+    job->fn = fn;
+    job->invoke = invoke;
+    job->destroy = destroy;
+    {
+        std::lock_guard<std::mutex> lock(m_jobs_mutex);
+        m_jobs.push_back(job);
+    }
+    m_unfinished.fetch_add(1, std::memory_order_relaxed);
+
+    if (t_current != nullptr)
+    {
+        t_current->spawned.push_back(job);
+    }
+    else
+    {
+        std::lock_guard<std::mutex> lock(m_jobs_mutex);
+        m_held.push_back(job);
+    }
+
+    return job;
+}
+
+void JobSystem::precede(Job* before, Job* after)
+{
+    std::lock_guard<std::mutex> lock(before->mutex);
+    if (before->finished) return;
+
+    after->pending.fetch_add(1, std::memory_order_relaxed);
+    before->successors.push_back(after);
+}
+
+void JobSystem::release(Job* job)
+{
+    if (job->pending.fetch_sub(1, std::memory_order_acq_rel) == 1)
+    {
+        push(job);
+    }
+}
+
+void JobSystem::push(Job* job)
+{
+    size_t queue {t_worker == NOT_A_WORKER ? 0 : t_worker};
+
+    // Counted before it becomes visible, so a thief never drives m_queued below zero
+    m_queued.fetch_add(1);
+    {
+        std::lock_guard<std::mutex> lock(m_queues[queue]->mutex);
+        m_queues[queue]->jobs.push_back(job);
+    }
+
+    // Sleepers recheck m_queued under m_mutex, so this wake is never lost
+    if (m_sleeping.load() > 0)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_wake.notify_one();
+    }
+}
+
+Job* JobSystem::findJob(size_t self)
+{
+    {
+        // Own work newest first, while it is still in cache
+        WorkerQueue& own {*m_queues[self]};
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (own.jobs.size() > own.head)
+        {
+            Job* job {own.jobs.back()};
+            own.jobs.pop_back();
+            if (own.jobs.size() == own.head)
+            {
+                own.jobs.clear();
+                own.head = 0;
+            }
+            m_queued.fetch_sub(1);
+            return job;
+        }
+    }
+
+    // Steal the oldest, usually the largest remaining piece of work
+    for (size_t k = 1; k < m_queues.size(); ++k)
+    {
+        WorkerQueue& victim {*m_queues[(self + k) % m_queues.size()]};
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (victim.jobs.size() > victim.head)
+        {
+            Job* job {victim.jobs[victim.head++]};
+            if (victim.jobs.size() == victim.head)
+            {
+                victim.jobs.clear();
+                victim.head = 0;
+            }
+            m_queued.fetch_sub(1);
+            ++m_stats[self].steals;
+            return job;
+        }
+    }
+
+    return nullptr;
+}
+
+void JobSystem::execute(Job* job, size_t self)
+{
+    Job* outer {t_current};
+    t_current = job;
+
+    uint64_t start {nowNs()};
+    {
+        RAST_PROFILE_SCOPE(job->name);
+        job->invoke(job->fn);
+    }
+    m_stats[self].busy_ns += nowNs() - start;
+    ++m_stats[self].jobs;
+
+    t_current = outer;
+    finish(job);
+}
+
+void JobSystem::finish(Job* job)
+{
+    {
+        std::lock_guard<std::mutex> lock(job->mutex);
+        job->finished = true;
+    }
+
+    // Successors and spawned jobs are counted as unfinished already, so
+    // releasing them first keeps run() from returning early
+    for (Job* next : job->successors)
+    {
+        release(next);
+    }
+    for (Job* next : job->spawned)
+    {
+        release(next);
+    }
+
+    if (m_unfinished.fetch_sub(1, std::memory_order_acq_rel) == 1)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_wake.notify_all();
+    }
+}
+
+void JobSystem::waitForWork(bool caller)
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_sleeping.fetch_add(1);
+    m_wake.wait(lock, [&] {
+        return m_stop || m_queued.load() > 0 || (caller && m_unfinished.load() == 0);
+    });
+    m_sleeping.fetch_sub(1);
+}
+
+void JobSystem::run()
+{
+    size_t outer {t_worker};
+    t_worker = 0;
+
+    {
+        std::lock_guard<std::mutex> lock(m_jobs_mutex);
+        for (Job* job : m_held)
+        {
+            release(job);
+        }
+        m_held.clear();
+    }
+
+    while (m_unfinished.load(std::memory_order_acquire) > 0)
+    {
+        Job* job {findJob(0)};
+        if (job != nullptr)
+        {
+            execute(job, 0);
+        }
+        else
+        {
+            waitForWork(true);
+        }
+    }
+
+    t_worker = outer;
+
+    // The arena takes the memory back on its next reset
+    std::lock_guard<std::mutex> lock(m_jobs_mutex);
+    for (Job* job : m_jobs)
+    {
+        job->destroy(job->fn);
+        job->~Job();
+    }
+    m_jobs.clear();
+}
+
+void JobSystem::workerLoop(size_t index)
+{
+    t_worker = index;
+    profileSetThreadName("job worker " + std::to_string(index));
+
+    while (true)
+    {
+        Job* job {findJob(index)};
+        if (job != nullptr)
+        {
+            execute(job, index);
+            continue;
+        }
+
+        waitForWork(false);
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_stop) return;
+    }
+}
+
+void JobSystem::beginFrame()
+{
+    for (WorkerStats& stats : m_stats)
+    {
+        stats = WorkerStats{};
+    }
+    m_frame_start = nowNs();
+}
+
+void JobSystem::endFrame()
+{
+    m_report.frame_ms = (double)(nowNs() - m_frame_start) / 1e6;
+
+    for (size_t i = 0; i < m_stats.size(); ++i)
+    {
+        m_report.workers[i] = WorkerReport{(double)m_stats[i].busy_ns / 1e6, m_stats[i].jobs, m_stats[i].steals};
+    }
+}
@@ -0,0 +1,559 @@
+#include "../include/lod.hpp"
+#include "../include/meshopt.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <functional>
+
+// Border planes are scaled up so open edges collapse last
+static constexpr double BORDER_WEIGHT {10.0};
+static constexpr uint32_t NO_VERTEX {~0u};
+
+using Point3 = std::array<double, 3>;
+
+// Symmetric 4x4 plane quadric: error(p) = p'Ap + 2b'p + c
+struct Quadric
+{
+    double a00, a01, a02, a11, a12, a22;
+    double b0, b1, b2;
+    double c;
+
+    Quadric& operator+=(const Quadric& o)
+    {
+        a00 += o.a00; a01 += o.a01; a02 += o.a02;
+        a11 += o.a11; a12 += o.a12; a22 += o.a22;
+        b0 += o.b0; b1 += o.b1; b2 += o.b2;
+        c += o.c;
+        return *this;
+    }
+};
+
+struct Collapse
+{
+    // Border-weighted quadric error, which orders the collapses
+    double error;
+    // Squared distance estimate from the unweighted quadrics, which is reported
+    double deviation;
+    uint32_t keep;
+    uint32_t remove;
+    uint32_t keep_version;
+    uint32_t remove_version;
+    Point3 pos;
+    float t;
+};
+
+static Point3 sub(const Point3& a, const Point3& b)
+{
+    return {a[0] - b[0], a[1] - b[1], a[2] - b[2]};
+}
+
+static Point3 cross(const Point3& a, const Point3& b)
+{
+    return {
+        a[1] * b[2] - a[2] * b[1],
+        a[2] * b[0] - a[0] * b[2],
+        a[0] * b[1] - a[1] * b[0]
+    };
+}
+
+static double dot(const Point3& a, const Point3& b)
+{
+    return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+}
+
+static bool normalize(Point3& v)
+{
+    double length {std::sqrt(dot(v, v))};
+    if (length <= 1e-20) return false;
+
+    v = {v[0] / length, v[1] / length, v[2] / length};
+    return true;
+}
+
+static Quadric planeQuadric(const Point3& n, double d, double weight)
+{
+    return Quadric{
+        weight * n[0] * n[0], weight * n[0] * n[1], weight * n[0] * n[2],
+        weight * n[1] * n[1], weight * n[1] * n[2], weight * n[2] * n[2],
+        weight * n[0] * d, weight * n[1] * d, weight * n[2] * d,
+        weight * d * d
+    };
+}
+
+static double evaluate(const Quadric& q, const Point3& p)
+{
+    double x {p[0]}, y {p[1]}, z {p[2]};
+    double e {
+        q.a00 * x * x + q.a11 * y * y + q.a22 * z * z +
+        2.0 * (q.a01 * x * y + q.a02 * x * z + q.a12 * y * z) +
+        2.0 * (q.b0 * x + q.b1 * y + q.b2 * z) +
+        q.c
+    };
+    return std::max(e, 0.0);
+}
+
+// Minimizer of the quadric, solving A p = -b; fails when A is near singular
+static bool optimalPoint(const Quadric& q, Point3& out)
+{
+    double det {
+        q.a00 * (q.a11 * q.a22 - q.a12 * q.a12) -
+        q.a01 * (q.a01 * q.a22 - q.a12 * q.a02) +
+        q.a02 * (q.a01 * q.a12 - q.a11 * q.a02)
+    };
+
+    double scale {std::abs(q.a00) + std::abs(q.a11) + std::abs(q.a22)};
+    if (std::abs(det) <= 1e-9 * scale * scale * scale) return false;
+
+    double c00 {q.a11 * q.a22 - q.a12 * q.a12};
+    double c01 {q.a02 * q.a12 - q.a01 * q.a22};
+    double c02 {q.a01 * q.a12 - q.a02 * q.a11};
+    double c11 {q.a00 * q.a22 - q.a02 * q.a02};
+    double c12 {q.a01 * q.a02 - q.a00 * q.a12};
+    double c22 {q.a00 * q.a11 - q.a01 * q.a01};
+
+    out = {
+        -(c00 * q.b0 + c01 * q.b1 + c02 * q.b2) / det,
+        -(c01 * q.b0 + c11 * q.b1 + c12 * q.b2) / det,
+        -(c02 * q.b0 + c12 * q.b1 + c22 * q.b2) / det
+    };
+    return true;
+}
+
+static uint64_t edgeKey(uint32_t a, uint32_t b)
+{
+    return a < b ? ((uint64_t)a << 32) | b : ((uint64_t)b << 32) | a;
+}
+
+static bool heapOrder(const Collapse& a, const Collapse& b)
+{
+    return a.error > b.error;
+}
+
+class Simplifier
+{
+    public:
+    Simplifier(const Mesh& m);
+
+    void run(size_t target_triangles);
+    Mesh result() const;
+    // Largest squared deviation of any applied collapse
+    double maxError() const {return m_max_error;}
+    size_t liveTriangles() const {return m_live_faces;}
+
+    private:
+    std::vector<Point3> m_pos;
+    std::vector<ColorRGB> m_color;
+    std::vector<Vector2> m_uv;
+    const Texture* m_texture;
+    std::vector<Quadric> m_quadric;
+    // The same planes without the border weight; only measures deviation
+    std::vector<Quadric> m_geometric;
+    std::vector<uint32_t> m_version;
+    std::vector<bool> m_vertex_alive;
+    std::vector<std::vector<uint32_t>> m_vertex_faces;
+
+    std::vector<std::array<uint32_t, 3>> m_faces;
+    std::vector<bool> m_face_alive;
+    size_t m_live_faces {0};
+
+    std::vector<Collapse> m_heap;
+    std::vector<uint32_t> m_stamp;
+    uint32_t m_current_stamp {0};
+    double m_max_error {0.0};
+
+    Collapse computeCollapse(uint32_t keep, uint32_t remove) const;
+    void pushCollapse(uint32_t keep, uint32_t remove);
+    bool isValid(const Collapse& c);
+    void apply(const Collapse& c);
+    uint32_t nextStamp();
+};
+
+Simplifier::Simplifier(const Mesh& m)
+: m_texture(m.texture)
+{
+    size_t vertex_count {m.vertices.size()};
+    size_t face_count {m.indices.size() / 3};
+
+    m_pos.resize(vertex_count);
+    m_color.resize(vertex_count);
+    m_uv.resize(vertex_count);
+    m_quadric.assign(vertex_count, Quadric{});
+    m_geometric.assign(vertex_count, Quadric{});
+    m_version.assign(vertex_count, 0);
+    m_vertex_alive.assign(vertex_count, true);
+    m_vertex_faces.resize(vertex_count);
+    m_stamp.assign(vertex_count, 0);
+
+    for (size_t i = 0; i < vertex_count; ++i)
+    {
+        const Vertex& v {m.vertices[i]};
+        m_pos[i] = {v.pos.x(), v.pos.y(), v.pos.z()};
+        m_color[i] = v.color;
+        m_uv[i] = v.uv;
+    }
+
+    m_faces.reserve(face_count);
+    std::vector<uint64_t> edges;
+    edges.reserve(face_count * 3);
+
+    for (size_t f = 0; f < face_count; ++f)
+    {
+        std::array<uint32_t, 3> face {m.indices[f * 3 + 0], m.indices[f * 3 + 1], m.indices[f * 3 + 2]};
+        if (face[0] == face[1] || face[1] == face[2] || face[0] == face[2]) continue;
+
+        uint32_t index {(uint32_t)m_faces.size()};
+        m_faces.push_back(face);
+
+        Point3 n {cross(sub(m_pos[face[1]], m_pos[face[0]]), sub(m_pos[face[2]], m_pos[face[0]]))};
+        if (normalize(n))
+        {
+            Quadric q {planeQuadric(n, -dot(n, m_pos[face[0]]), 1.0)};
+            for (uint32_t v : face)
+            {
+                m_quadric[v] += q;
+                m_geometric[v] += q;
+            }
+        }
+
+        for (int k = 0; k < 3; ++k)
+        {
+            m_vertex_faces[face[k]].push_back(index);
+            edges.push_back(edgeKey(face[k], face[(k + 1) % 3]));
+        }
+    }
+
+    m_face_alive.assign(m_faces.size(), true);
+    m_live_faces = m_faces.size();
+
+    // Edges used by a single face lie on a border
+    std::sort(edges.begin(), edges.end());
+    for (const std::array<uint32_t, 3>& face : m_faces)
+    {
+        Point3 n {cross(sub(m_pos[face[1]], m_pos[face[0]]), sub(m_pos[face[2]], m_pos[face[0]]))};
+        if (!normalize(n)) continue;
+
+        for (int k = 0; k < 3; ++k)
+        {
+            uint32_t a {face[k]};
+            uint32_t b {face[(k + 1) % 3]};
+            uint64_t key {edgeKey(a, b)};
+            auto range {std::equal_range(edges.begin(), edges.end(), key)};
+            if (range.second - range.first != 1) continue;
+
+            Point3 along {sub(m_pos[b], m_pos[a])};
+            if (!normalize(along)) continue;
+
+            Point3 side {cross(along, n)};
+            if (!normalize(side)) continue;
+
+            double d {-dot(side, m_pos[a])};
+            Quadric weighted {planeQuadric(side, d, BORDER_WEIGHT)};
+            Quadric q {planeQuadric(side, d, 1.0)};
+            m_quadric[a] += weighted;
+            m_quadric[b] += weighted;
+            m_geometric[a] += q;
+            m_geometric[b] += q;
+        }
+    }
+
+    edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+    m_heap.reserve(edges.size());
+    for (uint64_t key : edges)
+    {
+        pushCollapse((uint32_t)(key >> 32), (uint32_t)key);
+    }
+}
+
+uint32_t Simplifier::nextStamp()
+{
+    if (++m_current_stamp == 0)
+    {
+        std::fill(m_stamp.begin(), m_stamp.end(), 0);
+        m_current_stamp = 1;
+    }
+    return m_current_stamp;
+}
+
+Collapse Simplifier::computeCollapse(uint32_t keep, uint32_t remove) const
+{
+    Quadric q {m_quadric[keep]};
+    q += m_quadric[remove];
+
+    const Point3& a {m_pos[keep]};
+    const Point3& b {m_pos[remove]};
+    Point3 mid {(a[0] + b[0]) * 0.5, (a[1] + b[1]) * 0.5, (a[2] + b[2]) * 0.5};
+
+    Collapse best {evaluate(q, a), 0.0, keep, remove, m_version[keep], m_version[remove], a, 0.0f};
+
+    double e {evaluate(q, b)};
+    if (e < best.error) {best.error = e; best.pos = b; best.t = 1.0f;}
+
+    e = evaluate(q, mid);
+    if (e < best.error) {best.error = e; best.pos = mid; best.t = 0.5f;}
+
+    // The exact minimizer is only trusted close to the edge
+    Point3 optimal;
+    if (optimalPoint(q, optimal))
+    {
+        Point3 ab {sub(b, a)};
+        double length_sq {dot(ab, ab)};
+        double t {length_sq > 0.0 ? dot(sub(optimal, a), ab) / length_sq : 0.0};
+        Point3 offset {sub(optimal, mid)};
+
+        e = evaluate(q, optimal);
+        if (e < best.error && dot(offset, offset) <= length_sq)
+        {
+            best.error = e;
+            best.pos = optimal;
+            best.t = (float)std::clamp(t, 0.0, 1.0);
+        }
+    }
+
+    Quadric g {m_geometric[keep]};
+    g += m_geometric[remove];
+    best.deviation = evaluate(g, best.pos);
+
+    return best;
+}
+
+void Simplifier::pushCollapse(uint32_t keep, uint32_t remove)
+{
+    m_heap.push_back(computeCollapse(keep, remove));
+    std::push_heap(m_heap.begin(), m_heap.end(), heapOrder);
+}
+
+bool Simplifier::isValid(const Collapse& c)
+{
+    // Link condition: the endpoints may only share the vertices of the
+    // faces on the edge, otherwise the collapse pinches the surface
+    uint32_t stamp {nextStamp()};
+    for (uint32_t f : m_vertex_faces[c.keep])
+    {
+        if (!m_face_alive[f]) continue;
+        for (uint32_t v : m_faces[f]) m_stamp[v] = stamp;
+    }
+
+    // Distinct opposite vertices of the faces on the edge; double-sided
+    // meshes list each of these faces twice
+    uint32_t opposite[2] {NO_VERTEX, NO_VERTEX};
+    size_t opposite_count {0};
+    for (uint32_t f : m_vertex_faces[c.remove])
+    {
+        if (!m_face_alive[f]) continue;
+        const std::array<uint32_t, 3>& face {m_faces[f]};
+        if (face[0] != c.keep && face[1] != c.keep && face[2] != c.keep) continue;
+
+        for (uint32_t v : face)
+        {
+            if (v == c.keep || v == c.remove || v == opposite[0] || v == opposite[1]) continue;
+            if (opposite_count == 2) return false;
+            opposite[opposite_count++] = v;
+        }
+    }
+
+    uint32_t common_stamp {nextStamp()};
+    size_t common {0};
+    for (uint32_t f : m_vertex_faces[c.remove])
+    {
+        if (!m_face_alive[f]) continue;
+        for (uint32_t v : m_faces[f])
+        {
+            if (v == c.keep || v == c.remove) continue;
+            if (m_stamp[v] == stamp)
+            {
+                m_stamp[v] = common_stamp;
+                ++common;
+            }
+        }
+    }
+
+    if (common != opposite_count) return false;
+
+    // Reject collapses that flip a surviving face
+    for (uint32_t v : {c.keep, c.remove})
+    {
+        for (uint32_t f : m_vertex_faces[v])
+        {
+            if (!m_face_alive[f]) continue;
+
+            const std::array<uint32_t, 3>& face {m_faces[f]};
+            bool has_keep {face[0] == c.keep || face[1] == c.keep || face[2] == c.keep};
+            bool has_remove {face[0] == c.remove || face[1] == c.remove || face[2] == c.remove};
+            if (has_keep && has_remove) continue;
+
+            Point3 p[3];
+            for (int k = 0; k < 3; ++k)
+            {
+                p[k] = face[k] == v ? c.pos : m_pos[face[k]];
+            }
+
+            Point3 before {cross(sub(m_pos[face[1]], m_pos[face[0]]), sub(m_pos[face[2]], m_pos[face[0]]))};
+            Point3 after {cross(sub(p[1], p[0]), sub(p[2], p[0]))};
+            if (dot(before, after) <= 0.0) return false;
+        }
+    }
+
+    return true;
+}
+
+void Simplifier::apply(const Collapse& c)
+{
+    m_pos[c.keep] = c.pos;
+
+    ColorRGB keep_color {m_color[c.keep]};
+    ColorRGB remove_color {m_color[c.remove]};
+    m_color[c.keep] = keep_color * (1.0f - c.t) + remove_color * c.t;
+
+    Vector2 keep_uv {m_uv[c.keep]};
+    Vector2 remove_uv {m_uv[c.remove]};
+    m_uv[c.keep] = keep_uv * (1.0f - c.t) + remove_uv * c.t;
+
+    m_quadric[c.keep] += m_quadric[c.remove];
+    m_geometric[c.keep] += m_geometric[c.remove];
+    m_vertex_alive[c.remove] = false;
+    m_max_error = std::max(m_max_error, c.deviation);
+
+    for (uint32_t f : m_vertex_faces[c.remove])
+    {
+        if (!m_face_alive[f]) continue;
+
+        std::array<uint32_t, 3>& face {m_faces[f]};
+        if (face[0] == c.keep || face[1] == c.keep || face[2] == c.keep)
+        {
+            m_face_alive[f] = false;
+            --m_live_faces;
+            continue;
+        }
+
+        for (uint32_t& v : face)
+        {
+            if (v == c.remove) v = c.keep;
+        }
+        m_vertex_faces[c.keep].push_back(f);
+    }
+    m_vertex_faces[c.remove].clear();
+
+    std::vector<uint32_t>& faces {m_vertex_faces[c.keep]};
+    faces.erase(std::remove_if(faces.begin(), faces.end(), [this](uint32_t f) {return !m_face_alive[f];}), faces.end());
+
+    // Queued collapses touching the kept vertex are now stale
+    ++m_version[c.keep];
+
+    uint32_t stamp {nextStamp()};
+    m_stamp[c.keep] = stamp;
+    for (uint32_t f : faces)
+    {
+        for (uint32_t v : m_faces[f])
+        {
+            if (m_stamp[v] == stamp) continue;
+            m_stamp[v] = stamp;
+            pushCollapse(c.keep, v);
+        }
+    }
+}
+
+void Simplifier::run(size_t target_triangles)
+{
+    while (m_live_faces > target_triangles && !m_heap.empty())
+    {
+        std::pop_heap(m_heap.begin(), m_heap.end(), heapOrder);
+        Collapse c {m_heap.back()};
+        m_heap.pop_back();
+
+        if (!m_vertex_alive[c.keep] || !m_vertex_alive[c.remove]) continue;
+        if (c.keep_version != m_version[c.keep] || c.remove_version != m_version[c.remove]) continue;
+        if (!isValid(c)) continue;
+
+        apply(c);
+    }
+}
+
+Mesh Simplifier::result() const
+{
+    Mesh out;
+    out.vertices.reserve(m_pos.size());
+    for (size_t i = 0; i < m_pos.size(); ++i)
+    {
+        out.vertices.push_back(Vertex{
+            Vector3((float)m_pos[i][0], (float)m_pos[i][1], (float)m_pos[i][2]),
+            m_color[i],
+            m_uv[i]
+        });
+    }
+
+    out.indices.reserve(m_live_faces * 3);
+    for (size_t f = 0; f < m_faces.size(); ++f)
+    {
+        if (!m_face_alive[f]) continue;
+        out.indices.insert(out.indices.end(), m_faces[f].begin(), m_faces[f].end());
+    }
+
+    // Collapsed vertices are unreferenced and dropped here
+    optimizeVertexCache(out);
+    optimizeVertexFetch(out);
+    out.bounds = computeBounds(out.vertices.data(), out.vertices.size());
+    out.texture = m_texture;
+    return out;
+}
+
+Mesh simplifyMesh(const Mesh& m, size_t target_triangles, float* error_out)
+{
+    Simplifier simplifier(m);
+    simplifier.run(target_triangles);
+
+    if (error_out != nullptr)
+    {
+        *error_out = (float)std::sqrt(simplifier.maxError());
+    }
+    return simplifier.result();
+}
+
+LODChain buildLODChain(const Mesh& m, std::span<const float> ratios)
+{
+    LODChain chain;
+    std::vector<float> errors {0.0f};
+
+    size_t source_triangles {m.indices.size() / 3};
+
+    std::vector<float> sorted(ratios.begin(), ratios.end());
+    std::sort(sorted.begin(), sorted.end(), std::greater<float>());
+
+    // One collapse sequence serves every level, so quadrics always describe
+    // the source surface and each level costs only its extra collapses
+    Simplifier simplifier(m);
+
+    for (float ratio : sorted)
+    {
+        size_t target {(size_t)((double)source_triangles * ratio)};
+        size_t previous {(chain.meshes.empty() ? m : chain.meshes.back()).indices.size() / 3};
+        if (target == 0 || target >= previous) continue;
+
+        simplifier.run(target);
+        size_t triangles {simplifier.liveTriangles()};
+
+        // The simplifier stalled on locked topology; the level would only cost memory
+        if (triangles == 0 || triangles * 10 > previous * 9) continue;
+
+        chain.meshes.push_back(simplifier.result());
+        errors.push_back((float)std::sqrt(simplifier.maxError()));
+    }
+
+    // Views are taken once the meshes stop moving
+    chain.levels.push_back(LODLevel{getMeshView(m), errors[0]});
+    for (size_t i = 0; i < chain.meshes.size(); ++i)
+    {
+        chain.levels.push_back(LODLevel{getMeshView(chain.meshes[i]), errors[i + 1]});
+    }
+
+    return chain;
+}
+
+size_t selectLOD(const LODChain& chain, float pixels_per_unit, float max_error_pixels)
+{
+    for (size_t i = chain.levels.size(); i-- > 1;)
+    {
+        if (chain.levels[i].error * pixels_per_unit <= max_error_pixels) return i;
+    }
+    return 0;
+}
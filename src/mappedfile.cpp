@@ -0,0 +1,134 @@
+#include "../include/mappedfile.hpp"
+
+#include <stdexcept>
+#include <utility>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile(const std::string& filename)
+{
+#ifdef _WIN32
+    HANDLE file {CreateFileA(
+        filename.c_str(),
+        GENERIC_READ,
+        FILE_SHARE_READ,
+        nullptr,
+        OPEN_EXISTING,
+        FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN,
+        nullptr
+    )};
+
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        throw std::runtime_error("file " + filename + " not found.");
+    }
+    m_file = file;
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size))
+    {
+        release();
+        throw std::runtime_error("could not stat " + filename + ".");
+    }
+    m_size = (size_t)size.QuadPart;
+
+    // Zero-length files cannot be mapped
+    if (m_size == 0) return;
+
+    m_mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (m_mapping == nullptr)
+    {
+        release();
+        throw std::runtime_error("could not map " + filename + ".");
+    }
+
+    m_data = static_cast<const char*>(MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+#else
+    m_fd = open(filename.c_str(), O_RDONLY);
+    if (m_fd < 0)
+    {
+        throw std::runtime_error("file " + filename + " not found.");
+    }
+
+    struct stat info;
+    if (fstat(m_fd, &info) != 0)
+    {
+        release();
+        throw std::runtime_error("could not stat " + filename + ".");
+    }
+    m_size = (size_t)info.st_size;
+
+    // Zero-length files cannot be mapped
+    if (m_size == 0) return;
+
+    void* data {mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, m_fd, 0)};
+    m_data = data == MAP_FAILED ? nullptr : static_cast<const char*>(data);
+
+    if (m_data != nullptr)
+    {
+        madvise(data, m_size, MADV_SEQUENTIAL);
+    }
+#endif
+
+    if (m_data == nullptr)
+    {
+        release();
+        throw std::runtime_error("could not map " + filename + ".");
+    }
+}
+
+MappedFile::~MappedFile()
+{
+    release();
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept
+{
+    *this = std::move(other);
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept
+{
+    if (this != &other)
+    {
+        release();
+
+        m_data = std::exchange(other.m_data, nullptr);
+        m_size = std::exchange(other.m_size, 0);
+#ifdef _WIN32
+        m_file = std::exchange(other.m_file, nullptr);
+        m_mapping = std::exchange(other.m_mapping, nullptr);
+#else
+        m_fd = std::exchange(other.m_fd, -1);
+#endif
+    }
+
+    return *this;
+}
+
+void MappedFile::release()
+{
+#ifdef _WIN32
+    if (m_data != nullptr) UnmapViewOfFile(m_data);
+    if (m_mapping != nullptr) CloseHandle(m_mapping);
+    if (m_file != nullptr) CloseHandle(m_file);
+    m_mapping = nullptr;
+    m_file = nullptr;
+#else
+    if (m_data != nullptr) munmap(const_cast<char*>(m_data), m_size);
+    if (m_fd >= 0) ::close(m_fd);
+    m_fd = -1;
+#endif
+
+    m_data = nullptr;
+    m_size = 0;
+}
@@ -0,0 +1,187 @@
+#include "../include/math.hpp"
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define RAST_X86 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#define RAST_TARGET_AVX2 __attribute__((target("avx2,fma")))
+#else
+#define RAST_TARGET_AVX2
+#endif
+
+using TransformKernel = void (*)(const Matrix4x4&, const PointStream&, size_t, size_t, const Vector4Stream&);
+
+static void transformScalar(
+    const Matrix4x4& mat, const PointStream& in, size_t begin, size_t end, const Vector4Stream& out
+)
+{
+    const auto& m {mat.m};
+
+    for (size_t i = begin; i < end; ++i)
+    {
+        float x {in.x[i * in.stride]};
+        float y {in.y[i * in.stride]};
+        float z {in.z[i * in.stride]};
+
+        out.x[i] = m[0][0] * x + m[0][1] * y + m[0][2] * z + m[0][3];
+        out.y[i] = m[1][0] * x + m[1][1] * y + m[1][2] * z + m[1][3];
+        out.z[i] = m[2][0] * x + m[2][1] * y + m[2][2] * z + m[2][3];
+        out.w[i] = m[3][0] * x + m[3][1] * y + m[3][2] * z + m[3][3];
+    }
+}
+
+#ifdef RAST_X86
+
+static inline __m128 loadSSE(const float* p, size_t i, size_t stride)
+{
+    if (stride == 1) return _mm_loadu_ps(p + i);
+
+    const float* q {p + i * stride};
+    return _mm_setr_ps(q[0], q[stride], q[2 * stride], q[3 * stride]);
+}
+
+static void transformSSE(
+    const Matrix4x4& mat, const PointStream& in, size_t begin, size_t end, const Vector4Stream& out
+)
+{
+    const auto& m {mat.m};
+    __m128 c[4][4];
+    for (int r = 0; r < 4; ++r)
+        for (int k = 0; k < 4; ++k)
+            c[r][k] = _mm_set1_ps(m[r][k]);
+
+    float* dst[4] {out.x, out.y, out.z, out.w};
+    size_t i {begin};
+
+    for (; i + 4 <= end; i += 4)
+    {
+        __m128 x {loadSSE(in.x, i, in.stride)};
+        __m128 y {loadSSE(in.y, i, in.stride)};
+        __m128 z {loadSSE(in.z, i, in.stride)};
+
+        for (int r = 0; r < 4; ++r)
+        {
+            __m128 acc {_mm_add_ps(_mm_mul_ps(c[r][0], x), c[r][3])};
+            acc = _mm_add_ps(acc, _mm_mul_ps(c[r][1], y));
+            acc = _mm_add_ps(acc, _mm_mul_ps(c[r][2], z));
+            _mm_storeu_ps(dst[r] + i, acc);
+        }
+    }
+
+    transformScalar(mat, in, i, end, out);
+}
+
+RAST_TARGET_AVX2
+static inline __m256 loadAVX2(const float* p, size_t i, size_t stride, __m256i gather_index)
+{
+    if (stride == 1) return _mm256_loadu_ps(p + i);
+    return _mm256_i32gather_ps(p + i * stride, gather_index, 4);
+}
+
+RAST_TARGET_AVX2
+static void transformAVX2(
+    const Matrix4x4& mat, const PointStream& in, size_t begin, size_t end, const Vector4Stream& out
+)
+{
+    const auto& m {mat.m};
+    __m256 c[4][4];
+    for (int r = 0; r < 4; ++r)
+        for (int k = 0; k < 4; ++k)
+            c[r][k] = _mm256_set1_ps(m[r][k]);
+
+    int s {(int)in.stride};
+    __m256i gather_index {_mm256_setr_epi32(0, s, 2 * s, 3 * s, 4 * s, 5 * s, 6 * s, 7 * s)};
+
+    float* dst[4] {out.x, out.y, out.z, out.w};
+    size_t i {begin};
+
+    for (; i + 8 <= end; i += 8)
+    {
+        __m256 x {loadAVX2(in.x, i, in.stride, gather_index)};
+        __m256 y {loadAVX2(in.y, i, in.stride, gather_index)};
+        __m256 z {loadAVX2(in.z, i, in.stride, gather_index)};
+
+        for (int r = 0; r < 4; ++r)
+        {
+            __m256 acc {_mm256_fmadd_ps(c[r][0], x, c[r][3])};
+            acc = _mm256_fmadd_ps(c[r][1], y, acc);
+            acc = _mm256_fmadd_ps(c[r][2], z, acc);
+            _mm256_storeu_ps(dst[r] + i, acc);
+        }
+    }
+
+    transformScalar(mat, in, i, end, out);
+}
+
+static bool cpuHasAVX2()
+{
+#ifdef _MSC_VER
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7) return false;
+
+    __cpuid(info, 1);
+    bool fma {(info[2] & (1 << 12)) != 0};
+    bool osxsave {(info[2] & (1 << 27)) != 0};
+    if (!fma || !osxsave) return false;
+
+    // The OS has to save the YMM registers on context switches
+    if ((_xgetbv(0) & 0x6) != 0x6) return false;
+
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#endif
+}
+
+#endif
+
+SimdLevel simdLevel()
+{
+#ifdef RAST_X86
+    static const SimdLevel level {cpuHasAVX2() ? SimdLevel::AVX2 : SimdLevel::SSE};
+    return level;
+#else
+    return SimdLevel::Scalar;
+#endif
+}
+
+const char* simdLevelName(SimdLevel level)
+{
+    switch (level)
+    {
+        case SimdLevel::AVX2: return "AVX2";
+        case SimdLevel::SSE: return "SSE";
+        default: return "scalar";
+    }
+}
+
+static TransformKernel selectKernel()
+{
+    switch (simdLevel())
+    {
+#ifdef RAST_X86
+        case SimdLevel::AVX2: return transformAVX2;
+        case SimdLevel::SSE: return transformSSE;
+#endif
+        default: return transformScalar;
+    }
+}
+
+void Matrix4x4::MatMult(const PointStream& in, size_t count, const Vector4Stream& out) const
+{
+    MatMult(in, 0, count, out);
+}
+
+void Matrix4x4::MatMult(const PointStream& in, size_t begin, size_t end, const Vector4Stream& out) const
+{
+    static const TransformKernel kernel {selectKernel()};
+    kernel(*this, in, begin, end, out);
+}
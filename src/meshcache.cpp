@@ -0,0 +1,306 @@
+#include "../include/meshcache.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <stdexcept>
+#include <system_error>
+
+static uint64_t alignUp(uint64_t value)
+{
+    return (value + RAST::MESH_CACHE_ALIGNMENT - 1) & ~(RAST::MESH_CACHE_ALIGNMENT - 1);
+}
+
+static bool writeBlob(std::FILE* file, uint64_t offset, const void* data, size_t bytes)
+{
+    // Pad up to the aligned offset
+    static const char zeros[RAST::MESH_CACHE_ALIGNMENT] {};
+    long position {std::ftell(file)};
+    if (position < 0 || (uint64_t)position > offset) return false;
+
+    size_t padding {(size_t)(offset - position)};
+    if (std::fwrite(zeros, 1, padding, file) != padding) return false;
+
+    return bytes == 0 || std::fwrite(data, 1, bytes, file) == bytes;
+}
+
+static bool blobFits(uint64_t offset, uint64_t count, uint64_t element_size, size_t file_size)
+{
+    // Divided rather than multiplied, so a corrupt count cannot wrap around
+    return offset <= file_size && count <= (file_size - offset) / element_size;
+}
+
+static bool indicesInRange(const uint32_t* indices, size_t index_count, size_t vertex_count)
+{
+    for (size_t i {0}; i < index_count; ++i)
+    {
+        if (indices[i] >= vertex_count) return false;
+    }
+    return true;
+}
+
+static bool headerMatches(
+    const MeshCacheHeader& h,
+    size_t file_size,
+    uint64_t source_size,
+    int64_t source_mtime,
+    uint32_t flags
+)
+{
+    if (std::memcmp(h.magic, RAST::MESH_CACHE_MAGIC, sizeof(h.magic)) != 0) return false;
+    if (h.version != RAST::MESH_CACHE_VERSION) return false;
+    if (h.vertex_size != sizeof(Vertex) || h.index_size != sizeof(uint32_t)) return false;
+    if (h.source_size != source_size || h.source_mtime != source_mtime) return false;
+
+    // Stored LODs satisfy loads that don't want them, not the other way round
+    uint32_t stored {h.flags & ~RAST::MESH_CACHE_LODS};
+    if (stored != (flags & ~RAST::MESH_CACHE_LODS)) return false;
+    if ((flags & RAST::MESH_CACHE_LODS) && !(h.flags & RAST::MESH_CACHE_LODS)) return false;
+
+    if (h.flags & RAST::MESH_CACHE_LODS)
+    {
+        if (h.lod_offset % RAST::MESH_CACHE_ALIGNMENT) return false;
+        if (!blobFits(h.lod_offset, h.lod_count, sizeof(MeshCacheLOD), file_size)) return false;
+    }
+    else if (h.lod_count != 0)
+    {
+        return false;
+    }
+
+    return true;
+}
+
+// Views one vertex and index array pair of the file, if it is well formed
+static bool mapLevel(
+    const MappedFile& file,
+    uint64_t vertex_offset,
+    uint64_t vertex_count,
+    uint64_t index_offset,
+    uint64_t index_count,
+    const Bounds& bounds,
+    MeshView& out
+)
+{
+    // Blobs must be aligned and lie inside the file
+    if (vertex_offset % RAST::MESH_CACHE_ALIGNMENT || index_offset % RAST::MESH_CACHE_ALIGNMENT) return false;
+    if (!blobFits(vertex_offset, vertex_count, sizeof(Vertex), file.size())) return false;
+    if (!blobFits(index_offset, index_count, sizeof(uint32_t), file.size())) return false;
+
+    // Checked once here, like the OBJ parser does, so a corrupt file
+    // is rebuilt instead of indexing past the vertex array
+    const uint32_t* indices {reinterpret_cast<const uint32_t*>(file.data() + index_offset)};
+    if (!indicesInRange(indices, (size_t)index_count, (size_t)vertex_count)) return false;
+
+    out = MeshView{
+        reinterpret_cast<const Vertex*>(file.data() + vertex_offset),
+        (size_t)vertex_count,
+        indices,
+        (size_t)index_count,
+        bounds
+    };
+    return true;
+}
+
+std::string getMeshCachePath(const std::string& filename)
+{
+    return filename + ".meshcache";
+}
+
+void writeMeshCache(
+    const std::string& cache_filename,
+    const Mesh& mesh,
+    uint64_t source_size,
+    int64_t source_mtime,
+    uint32_t flags,
+    const LODChain* lods
+)
+{
+    MeshCacheHeader header {};
+    std::memcpy(header.magic, RAST::MESH_CACHE_MAGIC, sizeof(header.magic));
+    header.version = RAST::MESH_CACHE_VERSION;
+    header.vertex_size = sizeof(Vertex);
+    header.index_size = sizeof(uint32_t);
+    header.flags = lods != nullptr ? flags | RAST::MESH_CACHE_LODS : flags & ~RAST::MESH_CACHE_LODS;
+    header.source_size = source_size;
+    header.source_mtime = source_mtime;
+    header.vertex_count = mesh.vertices.size();
+    header.vertex_offset = alignUp(sizeof(MeshCacheHeader));
+    header.index_count = mesh.indices.size();
+    header.index_offset = alignUp(header.vertex_offset + mesh.vertices.size() * sizeof(Vertex));
+    header.bounds = mesh.bounds;
+
+    // Level 0 is the mesh itself; the table and the other levels follow it
+    std::vector<MeshCacheLOD> table;
+    uint64_t end {header.index_offset + mesh.indices.size() * sizeof(uint32_t)};
+    if (lods != nullptr)
+    {
+        header.lod_count = (uint32_t)(lods->levels.size() - 1);
+        header.lod_offset = alignUp(end);
+        end = header.lod_offset + header.lod_count * sizeof(MeshCacheLOD);
+
+        for (size_t i = 1; i < lods->levels.size(); ++i)
+        {
+            const MeshView& level {lods->levels[i].mesh};
+            MeshCacheLOD entry {};
+            entry.vertex_count = level.vertex_count;
+            entry.vertex_offset = alignUp(end);
+            entry.index_count = level.index_count;
+            entry.index_offset = alignUp(entry.vertex_offset + level.vertex_count * sizeof(Vertex));
+            entry.error = lods->levels[i].error;
+            entry.bounds = level.bounds;
+            end = entry.index_offset + level.index_count * sizeof(uint32_t);
+            table.push_back(entry);
+        }
+    }
+
+    // Written under a temporary name and renamed, so readers never see a partial file
+    std::string temp_filename {cache_filename + ".tmp"};
+    std::FILE* file {std::fopen(temp_filename.c_str(), "wb")};
+    if (file == nullptr)
+    {
+        throw std::runtime_error("could not create " + temp_filename + ".");
+    }
+
+    bool ok {
+        std::fwrite(&header, sizeof(header), 1, file) == 1 &&
+        writeBlob(file, header.vertex_offset, mesh.vertices.data(), mesh.vertices.size() * sizeof(Vertex)) &&
+        writeBlob(file, header.index_offset, mesh.indices.data(), mesh.indices.size() * sizeof(uint32_t)) &&
+        (table.empty() || writeBlob(file, header.lod_offset, table.data(), table.size() * sizeof(MeshCacheLOD)))
+    };
+    for (size_t i = 0; ok && i < table.size(); ++i)
+    {
+        const MeshView& level {lods->levels[i + 1].mesh};
+        ok = writeBlob(file, table[i].vertex_offset, level.vertices, level.vertex_count * sizeof(Vertex)) &&
+            writeBlob(file, table[i].index_offset, level.indices, level.index_count * sizeof(uint32_t));
+    }
+    ok = std::fclose(file) == 0 && ok;
+
+    std::error_code ec;
+    if (ok)
+    {
+        std::filesystem::rename(temp_filename, cache_filename, ec);
+    }
+
+    if (!ok || ec)
+    {
+        std::filesystem::remove(temp_filename, ec);
+        throw std::runtime_error("could not write " + cache_filename + ".");
+    }
+}
+
+CachedMesh loadCachedMesh(const std::string& filename, ObjParseMode mode, bool optimize, bool lods)
+{
+    std::error_code ec;
+    uint64_t source_size {std::filesystem::file_size(filename, ec)};
+    if (ec)
+    {
+        throw std::runtime_error("file " + filename + " not found.");
+    }
+    int64_t source_mtime {(int64_t)std::filesystem::last_write_time(filename, ec).time_since_epoch().count()};
+
+    std::string cache_filename {getMeshCachePath(filename)};
+    uint32_t flags {(optimize ? RAST::MESH_CACHE_OPTIMIZED : 0u) | (lods ? RAST::MESH_CACHE_LODS : 0u)};
+    CachedMesh result;
+
+    auto mapCache = [&]() {
+        if (!std::filesystem::exists(cache_filename, ec)) return false;
+
+        MappedFile file(cache_filename);
+        if (file.size() < sizeof(MeshCacheHeader)) return false;
+
+        MeshCacheHeader header;
+        std::memcpy(&header, file.data(), sizeof(header));
+        if (!headerMatches(header, file.size(), source_size, source_mtime, flags)) return false;
+
+        MeshView view;
+        if (!mapLevel(file, header.vertex_offset, header.vertex_count,
+            header.index_offset, header.index_count, header.bounds, view)) return false;
+
+        // Level 0 is filled in with the final view once the texture is known
+        std::unique_ptr<LODChain> chain;
+        if (lods)
+        {
+            chain = std::make_unique<LODChain>();
+            chain->levels.push_back(LODLevel{view, 0.0f});
+
+            const MeshCacheLOD* table {reinterpret_cast<const MeshCacheLOD*>(file.data() + header.lod_offset)};
+            for (uint32_t i = 0; i < header.lod_count; ++i)
+            {
+                LODLevel level {MeshView{}, table[i].error};
+                if (!mapLevel(file, table[i].vertex_offset, table[i].vertex_count,
+                    table[i].index_offset, table[i].index_count, table[i].bounds, level.mesh)) return false;
+                chain->levels.push_back(level);
+            }
+        }
+
+        result.m_view = view;
+        result.m_lods = std::move(chain);
+        result.m_file = std::move(file);
+        return true;
+    };
+
+    if (!mapCache())
+    {
+        Mesh mesh {getMeshFromObj(filename, mode)};
+        if (optimize)
+        {
+            optimizeMesh(mesh);
+        }
+
+        // Simplified from the final vertices, so every level keeps the
+        // optimization of the source, and stored with it
+        std::unique_ptr<LODChain> chain;
+        if (lods)
+        {
+            chain = std::make_unique<LODChain>(buildLODChain(mesh));
+        }
+
+        bool mapped {false};
+        try
+        {
+            writeMeshCache(cache_filename, mesh, source_size, source_mtime, flags, chain.get());
+            mapped = mapCache();
+        }
+        catch (const std::runtime_error& e)
+        {
+            SDL_Log("Mesh cache disabled for %s: %s", filename.c_str(), e.what());
+        }
+
+        // No usable cache, keep the parsed mesh in memory
+        if (!mapped)
+        {
+            result.m_owned = std::move(mesh);
+            result.m_view = getMeshView(result.m_owned);
+            result.m_lods = std::move(chain);
+        }
+    }
+
+    try
+    {
+        std::string texture_filename {getObjTexturePath(filename)};
+        if (!texture_filename.empty())
+        {
+            // On the heap so the view's pointer survives moving the CachedMesh
+            result.m_texture = std::make_unique<Texture>(loadTexture(texture_filename));
+            result.m_view.texture = result.m_texture.get();
+        }
+    }
+    catch (const std::runtime_error& e)
+    {
+        SDL_Log("Texture disabled for %s: %s", filename.c_str(), e.what());
+    }
+
+    if (result.m_lods)
+    {
+        // Level 0 is the view itself, and every level shares its texture.
+        // The chain is on the heap for the same reason as the texture.
+        result.m_lods->levels[0].mesh = result.m_view;
+        for (LODLevel& level : result.m_lods->levels)
+        {
+            level.mesh.texture = result.m_view.texture;
+        }
+        result.m_view.lods = result.m_lods.get();
+    }
+
+    return result;
+}
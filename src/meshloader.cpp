@@ -0,0 +1,139 @@
+#include "../include/meshloader.hpp"
+
+#include <SDL3/SDL.h>
+
+#include <exception>
+
+MeshLoader::MeshLoader(unsigned thread_count, std::function<void()> on_finished)
+: m_on_finished(std::move(on_finished))
+{
+    if (thread_count == 0)
+    {
+        unsigned hardware {std::thread::hardware_concurrency()};
+        thread_count = hardware > 1 ? hardware - 1 : 1;
+    }
+
+    m_workers.reserve(thread_count);
+    for (unsigned i = 0; i < thread_count; ++i)
+    {
+        m_workers.emplace_back(&MeshLoader::workerLoop, this);
+    }
+}
+
+MeshLoader::~MeshLoader()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+        m_queue.clear();
+    }
+    m_wake.notify_all();
+
+    for (auto& worker : m_workers)
+    {
+        worker.join();
+    }
+}
+
+MeshHandle MeshLoader::request(const std::string& filename, ObjParseMode mode, bool optimize, bool lods)
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    auto it {m_by_filename.find(filename)};
+    if (it != m_by_filename.end()) return it->second;
+
+    MeshHandle handle {(MeshHandle)m_requests.size()};
+    m_requests.push_back(std::make_unique<Request>());
+    m_requests.back()->filename = filename;
+    m_requests.back()->mode = mode;
+    m_requests.back()->optimize = optimize;
+    m_requests.back()->lods = lods;
+
+    m_by_filename.emplace(filename, handle);
+    m_queue.push_back(handle);
+    lock.unlock();
+
+    m_wake.notify_one();
+    return handle;
+}
+
+const MeshLoader::Request& MeshLoader::get(MeshHandle handle) const
+{
+    // The vector may grow under a concurrent request; the Request itself does not move
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return *m_requests[handle];
+}
+
+MeshLoadState MeshLoader::state(MeshHandle handle) const
+{
+    return get(handle).state.load(std::memory_order_acquire);
+}
+
+const MeshView* MeshLoader::view(MeshHandle handle) const
+{
+    return get(handle).view.load(std::memory_order_acquire);
+}
+
+const std::string& MeshLoader::filename(MeshHandle handle) const
+{
+    return get(handle).filename;
+}
+
+const std::string& MeshLoader::error(MeshHandle handle) const
+{
+    return get(handle).error;
+}
+
+void MeshLoader::poll(std::vector<MeshHandle>& finished)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    finished.insert(finished.end(), m_finished.begin(), m_finished.end());
+    m_finished.clear();
+}
+
+void MeshLoader::load(Request& request)
+{
+    request.state.store(MeshLoadState::Loading, std::memory_order_relaxed);
+
+    try
+    {
+        request.mesh = loadCachedMesh(request.filename, request.mode, request.optimize, request.lods);
+
+        // Release: the mesh data is complete before anyone can see the view
+        request.view.store(&request.mesh.view(), std::memory_order_release);
+        request.state.store(MeshLoadState::Ready, std::memory_order_release);
+    }
+    catch (const std::exception& e)
+    {
+        request.error = e.what();
+        request.state.store(MeshLoadState::Failed, std::memory_order_release);
+        SDL_Log("Could not load mesh %s: %s", request.filename.c_str(), e.what());
+    }
+}
+
+void MeshLoader::workerLoop()
+{
+    while (true)
+    {
+        Request* request;
+        MeshHandle handle;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_wake.wait(lock, [this] {return m_stop || !m_queue.empty();});
+            if (m_stop) return;
+
+            handle = m_queue.front();
+            m_queue.pop_front();
+            request = m_requests[handle].get();
+        }
+
+        load(*request);
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_finished.push_back(handle);
+        }
+
+        if (m_on_finished) m_on_finished();
+    }
+}
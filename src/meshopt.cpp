@@ -0,0 +1,284 @@
+#include "../include/meshopt.hpp"
+
+#include <cmath>
+#include <cstring>
+#include <unordered_map>
+
+struct VertexKey
+{
+    uint32_t bits[8];
+
+    bool operator==(const VertexKey& other) const
+    {
+        return std::memcmp(bits, other.bits, sizeof(bits)) == 0;
+    }
+};
+
+struct VertexKeyHash
+{
+    size_t operator()(const VertexKey& k) const
+    {
+        uint64_t h {1469598103934665603ull};
+        for (uint32_t b : k.bits)
+        {
+            h = (h ^ b) * 1099511628211ull;
+        }
+        return (size_t)h;
+    }
+};
+
+static VertexKey getVertexKey(const Vertex& v)
+{
+    // Adding 0 folds -0.0 into 0.0 so both weld together
+    float values[8] {
+        v.pos.x() + 0.0f, v.pos.y() + 0.0f, v.pos.z() + 0.0f,
+        v.color.r() + 0.0f, v.color.g() + 0.0f, v.color.b() + 0.0f,
+        v.uv.x() + 0.0f, v.uv.y() + 0.0f
+    };
+
+    VertexKey key;
+    std::memcpy(key.bits, values, sizeof(values));
+    return key;
+}
+
+float computeACMR(const std::vector<uint32_t>& indices, size_t vertex_count, int cache_size)
+{
+    if (indices.size() < 3) return 0.0f;
+
+    // A vertex is cached if it entered the FIFO within the last cache_size misses
+    std::vector<uint64_t> inserted(vertex_count, 0);
+    uint64_t misses {0};
+
+    for (uint32_t index : indices)
+    {
+        if (inserted[index] == 0 || misses - inserted[index] >= (uint64_t)cache_size)
+        {
+            ++misses;
+            inserted[index] = misses;
+        }
+    }
+
+    return (float)misses / (float)(indices.size() / 3);
+}
+
+void weldVertices(Mesh& m)
+{
+    std::unordered_map<VertexKey, uint32_t, VertexKeyHash> unique;
+    unique.reserve(m.vertices.size());
+
+    std::vector<uint32_t> remap(m.vertices.size());
+    std::vector<Vertex> vertices;
+    vertices.reserve(m.vertices.size());
+
+    for (size_t i = 0; i < m.vertices.size(); ++i)
+    {
+        auto [it, inserted] {unique.try_emplace(getVertexKey(m.vertices[i]), (uint32_t)vertices.size())};
+        if (inserted)
+        {
+            vertices.push_back(m.vertices[i]);
+        }
+        remap[i] = it->second;
+    }
+
+    for (uint32_t& index : m.indices)
+    {
+        index = remap[index];
+    }
+
+    m.vertices = std::move(vertices);
+}
+
+static float forsythVertexScore(int cache_position, uint32_t remaining)
+{
+    constexpr float CACHE_DECAY_POWER {1.5f};
+    constexpr float LAST_TRIANGLE_SCORE {0.75f};
+    constexpr float VALENCE_BOOST_SCALE {2.0f};
+    constexpr float VALENCE_BOOST_POWER {0.5f};
+
+    if (remaining == 0) return -1.0f;
+
+    float score {0.0f};
+
+    if (cache_position >= 0)
+    {
+        // The last triangle's vertices score a fixed amount, so the next
+        // triangle does not just reuse the same edge
+        if (cache_position < 3)
+        {
+            score = LAST_TRIANGLE_SCORE;
+        }
+        else
+        {
+            float scaler {1.0f / (RAST::OPTIMIZE_CACHE_SIZE - 3)};
+            score = std::pow(1.0f - (cache_position - 3) * scaler, CACHE_DECAY_POWER);
+        }
+    }
+
+    // Vertices with few triangles left are finished off first
+    score += VALENCE_BOOST_SCALE * std::pow((float)remaining, -VALENCE_BOOST_POWER);
+    return score;
+}
+
+void optimizeVertexCache(Mesh& m)
+{
+    size_t triangle_count {m.indices.size() / 3};
+    size_t vertex_count {m.vertices.size()};
+    if (triangle_count == 0) return;
+
+    // Vertex to triangle adjacency; each vertex's live triangles are kept at
+    // the front of its range
+    std::vector<uint32_t> remaining(vertex_count, 0);
+    for (uint32_t index : m.indices) ++remaining[index];
+
+    std::vector<uint32_t> offsets(vertex_count + 1, 0);
+    for (size_t v = 0; v < vertex_count; ++v) offsets[v + 1] = offsets[v] + remaining[v];
+
+    std::vector<uint32_t> adjacency(m.indices.size());
+    {
+        std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+        for (size_t i = 0; i < m.indices.size(); ++i)
+        {
+            adjacency[fill[m.indices[i]]++] = (uint32_t)(i / 3);
+        }
+    }
+
+    std::vector<int> cache_position(vertex_count, -1);
+    std::vector<float> vertex_score(vertex_count);
+    for (size_t v = 0; v < vertex_count; ++v)
+    {
+        vertex_score[v] = forsythVertexScore(-1, remaining[v]);
+    }
+
+    std::vector<float> triangle_score(triangle_count);
+    std::vector<bool> emitted(triangle_count, false);
+    for (size_t t = 0; t < triangle_count; ++t)
+    {
+        const uint32_t* tri {&m.indices[t * 3]};
+        triangle_score[t] = vertex_score[tri[0]] + vertex_score[tri[1]] + vertex_score[tri[2]];
+    }
+
+    std::vector<uint32_t> output;
+    output.reserve(m.indices.size());
+
+    // Room for a full cache plus the three vertices being pushed in
+    std::vector<uint32_t> cache;
+    std::vector<uint32_t> next_cache;
+    cache.reserve(RAST::OPTIMIZE_CACHE_SIZE + 3);
+    next_cache.reserve(RAST::OPTIMIZE_CACHE_SIZE + 3);
+
+    size_t scan {0};
+    int64_t best {-1};
+
+    while (output.size() < m.indices.size())
+    {
+        // Nothing in the cache has triangles left, take the next unused one
+        if (best < 0)
+        {
+            while (emitted[scan]) ++scan;
+            best = (int64_t)scan;
+        }
+
+        const uint32_t* tri {&m.indices[best * 3]};
+        emitted[best] = true;
+
+        for (int k = 0; k < 3; ++k)
+        {
+            uint32_t v {tri[k]};
+            output.push_back(v);
+
+            // Drop the triangle from the vertex's live range
+            uint32_t* begin {&adjacency[offsets[v]]};
+            uint32_t* end {begin + remaining[v]};
+            for (uint32_t* it = begin; it != end; ++it)
+            {
+                if (*it == (uint32_t)best)
+                {
+                    std::swap(*it, *(end - 1));
+                    break;
+                }
+            }
+            --remaining[v];
+        }
+
+        // Most recent vertices go to the front, the rest keep their order
+        next_cache.assign(tri, tri + 3);
+        for (uint32_t v : cache)
+        {
+            if (v != tri[0] && v != tri[1] && v != tri[2]) next_cache.push_back(v);
+        }
+
+        for (size_t i = 0; i < next_cache.size(); ++i)
+        {
+            uint32_t v {next_cache[i]};
+            cache_position[v] = i < (size_t)RAST::OPTIMIZE_CACHE_SIZE ? (int)i : -1;
+            vertex_score[v] = forsythVertexScore(cache_position[v], remaining[v]);
+        }
+
+        // Rescore the live triangles around every vertex whose score moved
+        best = -1;
+        float best_score {-1.0f};
+
+        for (uint32_t v : next_cache)
+        {
+            for (uint32_t a = offsets[v]; a < offsets[v] + remaining[v]; ++a)
+            {
+                uint32_t t {adjacency[a]};
+                const uint32_t* other {&m.indices[t * 3]};
+                triangle_score[t] = vertex_score[other[0]] + vertex_score[other[1]] + vertex_score[other[2]];
+
+                if (triangle_score[t] > best_score)
+                {
+                    best_score = triangle_score[t];
+                    best = t;
+                }
+            }
+        }
+
+        if (next_cache.size() > (size_t)RAST::OPTIMIZE_CACHE_SIZE)
+        {
+            next_cache.resize(RAST::OPTIMIZE_CACHE_SIZE);
+        }
+        std::swap(cache, next_cache);
+    }
+
+    m.indices = std::move(output);
+}
+
+void optimizeVertexFetch(Mesh& m)
+{
+    constexpr uint32_t UNUSED {~0u};
+
+    std::vector<uint32_t> remap(m.vertices.size(), UNUSED);
+    std::vector<Vertex> vertices;
+    vertices.reserve(m.vertices.size());
+
+    for (uint32_t& index : m.indices)
+    {
+        if (remap[index] == UNUSED)
+        {
+            remap[index] = (uint32_t)vertices.size();
+            vertices.push_back(m.vertices[index]);
+        }
+        index = remap[index];
+    }
+
+    m.vertices = std::move(vertices);
+}
+
+void optimizeMesh(Mesh& m)
+{
+    size_t vertices_before {m.vertices.size()};
+    float acmr_before {computeACMR(m.indices, m.vertices.size())};
+
+    weldVertices(m);
+    optimizeVertexCache(m);
+    optimizeVertexFetch(m);
+
+    // Unused vertices may have been dropped
+    m.bounds = computeBounds(m.vertices.data(), m.vertices.size());
+
+    float acmr_after {computeACMR(m.indices, m.vertices.size())};
+
+    SDL_Log("Mesh optimization: ACMR %.3f -> %.3f, %zu -> %zu vertices, %d triangles",
+        acmr_before, acmr_after, vertices_before, m.vertices.size(), getMeshLength(m));
+}
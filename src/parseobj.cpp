@@ -1,50 +1,544 @@
 #include "../include/parseobj.hpp"
+#include "../include/mappedfile.hpp"
+#include "../include/threadpool.hpp"
 
-Mesh getMeshFromObj(const std::string& filename)
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <exception>
+#include <filesystem>
+#include <limits>
+#include <stdexcept>
+#include <unordered_map>
+
+// Files smaller than this are not worth splitting across threads
+constexpr size_t PARALLEL_MIN_BYTES {1 << 20};
+
+// uv_indices entry of a corner written without a vt index
+constexpr uint32_t NO_TEXCOORD {std::numeric_limits<uint32_t>::max()};
+
+// Vertices and faces of one newline-aligned slice of the file
+struct ObjChunk
+{
+    ObjChunk() = default;
+    ObjChunk(const char* b, const char* e)
+    : begin(b), end(e) {}
+
+    const char* begin {nullptr};
+    const char* end {nullptr};
+
+    Mesh mesh;
+
+    // vt records, and for every entry of mesh.indices the one its corner uses
+    std::vector<Vector2> texcoords;
+    std::vector<uint32_t> uv_indices;
+    // Some v record carried a color
+    bool colored {false};
+
+    // Negative indices count back from the vertices read so far, which can
+    // reach into earlier chunks. They are kept as (position in mesh.indices,
+    // chunk-relative index) and resolved once the chunk's base is known.
+    std::vector<std::pair<size_t, int64_t>> relative;
+    // The same for vt indices, resolved against the texcoords
+    std::vector<std::pair<size_t, int64_t>> relative_uv;
+};
+
+struct FaceCorner
+{
+    int64_t index;
+    bool relative;
+
+    int64_t uv;
+    bool uv_relative;
+};
+
+static inline const char* skipSpaces(const char* p, const char* end)
 {
-    std::ifstream file(filename);
-    
-    if(!file)
+    while (p < end && (*p == ' ' || *p == '\t')) ++p;
+    return p;
+}
+
+static inline const char* nextLine(const char* p, const char* end)
+{
+    const void* newline {std::memchr(p, '\n', end - p)};
+    return newline ? static_cast<const char*>(newline) + 1 : end;
+}
+
+static inline bool isRecord(const char* p, const char* end, char type)
+{
+    return end - p >= 2 && p[0] == type && (p[1] == ' ' || p[1] == '\t');
+}
+
+static inline bool isRecord(const char* p, const char* end, const char* keyword)
+{
+    size_t length {std::strlen(keyword)};
+    return (
+        (size_t)(end - p) > length && std::memcmp(p, keyword, length) == 0 &&
+        (p[length] == ' ' || p[length] == '\t')
+    );
+}
+
+static inline bool atLineEnd(const char* p, const char* end)
+{
+    return p == end || *p == '\n' || *p == '\r' || *p == '#';
+}
+
+static const char* parseFloat(const char* p, const char* end, float& out)
+{
+    p = skipSpaces(p, end);
+    if (p < end && *p == '+') ++p;
+
+    auto [next, ec] {std::from_chars(p, end, out)};
+    if (ec != std::errc())
     {
-        throw std::runtime_error("file " + filename + "not found.");
+        throw std::runtime_error("malformed vertex record.");
     }
 
-    Mesh mesh;
-    std::string line;
+    return next;
+}
 
-    while (std::getline(file, line))
+// Counts v, vt and f records so the vectors can be sized before parsing
+static void countRecords(const char* p, const char* end, size_t& vertices, size_t& texcoords, size_t& faces)
+{
+    vertices = 0;
+    texcoords = 0;
+    faces = 0;
+
+    while (p < end)
     {
-        std::istringstream iss(line);
-        std::string prefix;
+        const char* line {skipSpaces(p, end)};
+
+        if (isRecord(line, end, 'v')) ++vertices;
+        else if (isRecord(line, end, "vt")) ++texcoords;
+        else if (isRecord(line, end, 'f')) ++faces;
+
+        p = nextLine(line, end);
+    }
+}
 
-        iss >> prefix;
+static void pushCorner(ObjChunk& chunk, const FaceCorner& corner)
+{
+    if (corner.relative)
+    {
+        chunk.relative.emplace_back(chunk.mesh.indices.size(), corner.index);
+    }
+    if (corner.uv_relative)
+    {
+        chunk.relative_uv.emplace_back(chunk.uv_indices.size(), corner.uv);
+    }
+    chunk.mesh.indices.push_back((uint32_t)corner.index);
+    chunk.uv_indices.push_back((uint32_t)corner.uv);
+}
+
+// One OBJ index, 1-based or negative from the end
+static const char* parseIndex(const char* p, const char* end, int64_t& index)
+{
+    auto [next, ec] {std::from_chars(p, end, index)};
+    if (ec != std::errc() || index == 0 || index > std::numeric_limits<uint32_t>::max())
+    {
+        throw std::runtime_error("malformed face record.");
+    }
+    return next;
+}
+
+static void parseFace(const char* p, const char* end, ObjChunk& chunk)
+{
+    FaceCorner first {};
+    FaceCorner previous {};
+    int corners {0};
 
-        if (prefix == "v")
+    while (true)
+    {
+        p = skipSpaces(p, end);
+        if (atLineEnd(p, end)) break;
+
+        int64_t index {0};
+        p = parseIndex(p, end, index);
+
+        // v/vt, v/vt/vn or v//vn; the vt index is optional
+        int64_t uv {0};
+        if (p < end && *p == '/' && p + 1 < end && p[1] != '/')
+        {
+            p = parseIndex(p + 1, end, uv);
+        }
+
+        // Skip the /vn part of the corner
+        while (p < end && *p != ' ' && *p != '\t' && *p != '\n' && *p != '\r') ++p;
+
+        FaceCorner current {
+            index > 0 ? index - 1 : (int64_t)chunk.mesh.vertices.size() + index,
+            index < 0,
+            uv > 0 ? uv - 1 : (uv < 0 ? (int64_t)chunk.texcoords.size() + uv : (int64_t)NO_TEXCOORD),
+            uv < 0
+        };
+
+        // Polygons are split into a triangle fan
+        if (corners >= 2)
+        {
+            pushCorner(chunk, first);
+            pushCorner(chunk, previous);
+            pushCorner(chunk, current);
+        }
+        else if (corners == 0)
+        {
+            first = current;
+        }
+
+        previous = current;
+        ++corners;
+    }
+}
+
+static void parseChunk(ObjChunk& chunk)
+{
+    const char* p {chunk.begin};
+    const char* end {chunk.end};
+    Mesh& mesh {chunk.mesh};
+
+    size_t vertex_count, texcoord_count, face_count;
+    countRecords(p, end, vertex_count, texcoord_count, face_count);
+    mesh.vertices.reserve(vertex_count);
+    mesh.indices.reserve(face_count * 3);
+    chunk.texcoords.reserve(texcoord_count);
+    chunk.uv_indices.reserve(face_count * 3);
+
+    while (p < end)
+    {
+        const char* line {skipSpaces(p, end)};
+
+        if (isRecord(line, end, 'v'))
         {
             float x, y, z;
-            iss >> x >> y >> z;
+            const char* q {parseFloat(line + 2, end, x)};
+            q = parseFloat(q, end, y);
+            q = parseFloat(q, end, z);
+
+            // "v x y z r g b" carries a color; a lone fourth value is a weight
+            float extra[3];
+            int extra_count {0};
+            while (extra_count < 3 && !atLineEnd(skipSpaces(q, end), end))
+            {
+                q = parseFloat(q, end, extra[extra_count++]);
+            }
+
+            ColorRGB color {1.0f, 0.0f, 1.0f};
+            if (extra_count == 3)
+            {
+                color = ColorRGB(extra[0], extra[1], extra[2]);
+                chunk.colored = true;
+            }
 
-            Vertex v {
-                {x, y, z},
-                {1.0f, 0.0f, 1.0f}
-            };
+            mesh.vertices.push_back(Vertex{{x, y, z}, color});
+        }
+        else if (isRecord(line, end, "vt"))
+        {
+            float u, v {0.0f};
+            const char* q {parseFloat(line + 3, end, u)};
+            if (!atLineEnd(skipSpaces(q, end), end)) parseFloat(q, end, v);
 
-            mesh.vertices.push_back(v);
+            // OBJ puts v = 0 at the bottom of the image, textures start at the top row
+            chunk.texcoords.emplace_back(u, 1.0f - v);
         }
-        if (prefix == "f")
+        else if (isRecord(line, end, 'f'))
         {
-            std::string indices;
+            parseFace(line + 2, end, chunk);
+        }
+
+        p = nextLine(line, end);
+    }
+}
+
+// Splits [begin, end) into up to count pieces that each start on a new line
+static std::vector<ObjChunk> splitChunks(const char* begin, const char* end, size_t count)
+{
+    std::vector<ObjChunk> chunks;
+    size_t step {(size_t)(end - begin) / count + 1};
+    const char* p {begin};
+
+    while (p < end)
+    {
+        const char* split {(size_t)(end - p) > step ? nextLine(p + step, end) : end};
+        chunks.push_back(ObjChunk{p, split});
+        p = split;
+    }
 
-            for (int i = 0; i < 3; ++i)
+    return chunks;
+}
+
+// Offsets each chunk by the vertices, texcoords and indices of the chunks
+// before it, then copies everything into one chunk with indices made global
+static ObjChunk stitchChunks(std::vector<ObjChunk>& chunks, ThreadPool* pool)
+{
+    std::vector<size_t> vertex_base(chunks.size());
+    std::vector<size_t> uv_base(chunks.size());
+    std::vector<size_t> index_base(chunks.size());
+    size_t vertex_count {0};
+    size_t uv_count {0};
+    size_t index_count {0};
+    bool colored {false};
+
+    for (size_t i = 0; i < chunks.size(); ++i)
+    {
+        vertex_base[i] = vertex_count;
+        uv_base[i] = uv_count;
+        index_base[i] = index_count;
+        vertex_count += chunks[i].mesh.vertices.size();
+        uv_count += chunks[i].texcoords.size();
+        index_count += chunks[i].mesh.indices.size();
+        colored = colored || chunks[i].colored;
+    }
+
+    auto resolve = [&](size_t i, ObjChunk& out, size_t offset) {
+        for (auto [position, local] : chunks[i].relative)
+        {
+            int64_t global {(int64_t)vertex_base[i] + local};
+            if (global < 0)
             {
-                iss >> indices;
-                size_t pos = indices.find("/");
-                uint32_t index = std::stoi(indices.substr(0, pos));
+                throw std::runtime_error("face index out of range.");
+            }
+            out.mesh.indices[offset + position] = (uint32_t)global;
+        }
 
-                mesh.indices.push_back(index - 1);
+        for (auto [position, local] : chunks[i].relative_uv)
+        {
+            int64_t global {(int64_t)uv_base[i] + local};
+            if (global < 0)
+            {
+                throw std::runtime_error("texture coordinate index out of range.");
             }
+            out.uv_indices[offset + position] = (uint32_t)global;
+        }
+    };
+
+    // A single chunk needs no copy
+    if (chunks.size() == 1)
+    {
+        resolve(0, chunks[0], 0);
+        return std::move(chunks[0]);
+    }
+
+    ObjChunk whole {};
+    whole.mesh.vertices.resize(vertex_count);
+    whole.mesh.indices.resize(index_count);
+    whole.texcoords.resize(uv_count);
+    whole.uv_indices.resize(index_count);
+    whole.colored = colored;
+
+    std::vector<std::exception_ptr> errors(chunks.size());
+
+    pool->parallelFor(chunks.size(), [&](size_t i) {
+        try
+        {
+            ObjChunk& part {chunks[i]};
+            std::copy(part.mesh.vertices.begin(), part.mesh.vertices.end(), whole.mesh.vertices.begin() + vertex_base[i]);
+            std::copy(part.mesh.indices.begin(), part.mesh.indices.end(), whole.mesh.indices.begin() + index_base[i]);
+            std::copy(part.texcoords.begin(), part.texcoords.end(), whole.texcoords.begin() + uv_base[i]);
+            std::copy(part.uv_indices.begin(), part.uv_indices.end(), whole.uv_indices.begin() + index_base[i]);
+            resolve(i, whole, index_base[i]);
+            part.mesh = Mesh{};
+            part.texcoords = {};
+            part.uv_indices = {};
+        }
+        catch (...)
+        {
+            errors[i] = std::current_exception();
+        }
+    });
+
+    for (auto& error : errors)
+    {
+        if (error) std::rethrow_exception(error);
+    }
+
+    return whole;
+}
+
+// Gives every distinct (v, vt) pair its own vertex, so corners sharing a
+// position across a texture seam keep their own coordinates
+static void weldTexcoords(ObjChunk& whole)
+{
+    Mesh& mesh {whole.mesh};
+
+    std::vector<Vertex> vertices;
+    vertices.reserve(mesh.vertices.size());
+    std::unordered_map<uint64_t, uint32_t> welded;
+    welded.reserve(mesh.vertices.size());
+
+    for (size_t i = 0; i < mesh.indices.size(); ++i)
+    {
+        uint32_t uv {whole.uv_indices[i]};
+        uint64_t key {(uint64_t)mesh.indices[i] << 32 | uv};
+
+        auto [it, inserted] {welded.try_emplace(key, (uint32_t)vertices.size())};
+        if (inserted)
+        {
+            Vertex v {mesh.vertices[mesh.indices[i]]};
+            if (uv != NO_TEXCOORD) v.uv = whole.texcoords[uv];
+            vertices.push_back(v);
+        }
+        mesh.indices[i] = it->second;
+    }
+
+    mesh.vertices = std::move(vertices);
+}
+
+// Shared by every parallel parse, so loading many files starts the workers once
+static ThreadPool& parsePool()
+{
+    static ThreadPool pool;
+    return pool;
+}
+
+Mesh getMeshFromObj(const std::string& filename, ObjParseMode mode)
+{
+    MappedFile file(filename);
+
+    const char* begin {file.data()};
+    const char* end {begin + file.size()};
+
+    bool parallel {mode == ObjParseMode::Parallel && file.size() >= PARALLEL_MIN_BYTES};
+    ThreadPool* pool {parallel ? &parsePool() : nullptr};
+    std::vector<ObjChunk> chunks;
+
+    if (parallel)
+    {
+        chunks = splitChunks(begin, end, pool->size() * 4);
+    }
+    else
+    {
+        chunks.push_back(ObjChunk{begin, end});
+    }
+
+    ObjChunk whole {};
+
+    try
+    {
+        std::vector<std::exception_ptr> errors(chunks.size());
+
+        auto parse = [&](size_t i) {
+            try
+            {
+                parseChunk(chunks[i]);
+            }
+            catch (...)
+            {
+                errors[i] = std::current_exception();
+            }
+        };
+
+        if (pool) pool->parallelFor(chunks.size(), parse);
+        else parse(0);
+
+        for (auto& error : errors)
+        {
+            if (error) std::rethrow_exception(error);
+        }
+
+        whole = stitchChunks(chunks, pool);
+    }
+    catch (const std::runtime_error& e)
+    {
+        throw std::runtime_error(filename + ": " + e.what());
+    }
+
+    Mesh& mesh {whole.mesh};
+
+    for (uint32_t index : mesh.indices)
+    {
+        if (index >= mesh.vertices.size())
+        {
+            throw std::runtime_error(filename + ": face index out of range.");
+        }
+    }
+
+    if (!whole.texcoords.empty())
+    {
+        for (uint32_t uv : whole.uv_indices)
+        {
+            if (uv != NO_TEXCOORD && uv >= whole.texcoords.size())
+            {
+                throw std::runtime_error(filename + ": texture coordinate index out of range.");
+            }
+        }
+
+        // Uncolored vertices show the texture unmodulated rather than magenta
+        if (!whole.colored)
+        {
+            for (Vertex& v : mesh.vertices) v.color = ColorRGB(1.0f, 1.0f, 1.0f);
+        }
+
+        weldTexcoords(whole);
+    }
+
+    mesh.bounds = computeBounds(mesh.vertices.data(), mesh.vertices.size());
+
+    return std::move(mesh);
+}
+
+// Rest of a "keyword value" line, trimmed
+static std::string recordValue(const char* p, const char* end)
+{
+    p = skipSpaces(p, end);
+    const char* stop {p};
+    while (stop < end && *stop != '\n' && *stop != '#') ++stop;
+    while (stop > p && (stop[-1] == ' ' || stop[-1] == '\t' || stop[-1] == '\r')) --stop;
+    return std::string(p, stop);
+}
+
+std::string getObjTexturePath(const std::string& filename)
+{
+    std::string library;
+    std::string material;
+
+    {
+        MappedFile file(filename);
+        const char* p {file.data()};
+        const char* end {p + file.size()};
+
+        while (p < end && (library.empty() || material.empty()))
+        {
+            const char* line {skipSpaces(p, end)};
+
+            if (library.empty() && isRecord(line, end, "mtllib")) library = recordValue(line + 6, end);
+            else if (material.empty() && isRecord(line, end, "usemtl")) material = recordValue(line + 6, end);
+
+            p = nextLine(line, end);
+        }
+    }
+
+    if (library.empty()) return {};
+
+    std::filesystem::path library_path {std::filesystem::path(filename).parent_path() / library};
+    std::ifstream mtl(library_path);
+    if (!mtl)
+    {
+        throw std::runtime_error("could not open material library " + library_path.string() + ".");
+    }
+
+    // Without usemtl the first material is taken
+    bool in_material {false};
+    std::string line;
+    while (std::getline(mtl, line))
+    {
+        const char* begin {skipSpaces(line.data(), line.data() + line.size())};
+        const char* end {line.data() + line.size()};
+
+        if (isRecord(begin, end, "newmtl"))
+        {
+            std::string name {recordValue(begin + 6, end)};
+            if (in_material) break;
+            in_material = material.empty() || name == material;
+        }
+        else if (in_material && isRecord(begin, end, "map_Kd"))
+        {
+            // Options such as -s or -o come first; the file name is last
+            std::string value {recordValue(begin + 6, end)};
+            size_t split {value.find_last_of(" \t")};
+            std::string texture {split == std::string::npos ? value : value.substr(split + 1)};
+
+            return (library_path.parent_path() / texture).string();
         }
     }
 
-    return mesh;
+    return {};
 }
@@ -0,0 +1,239 @@
+#include "../include/profiler.hpp"
+
+#ifdef RAST_PROFILE
+
+#include <SDL3/SDL.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <mutex>
+
+struct ProfileEvent
+{
+    const char* name;
+    uint64_t start;
+    // End time for zones, value for counters
+    uint64_t end_or_value;
+    bool counter;
+};
+
+// Events of the current frame, appended only by the owning thread
+struct ThreadLog
+{
+    uint32_t tid;
+    std::string name;
+    std::vector<ProfileEvent> events;
+};
+
+struct CapturedEvent
+{
+    uint32_t tid;
+    ProfileEvent event;
+};
+
+struct ProfilerState
+{
+    std::mutex mutex;
+    std::vector<std::unique_ptr<ThreadLog>> threads;
+
+    uint64_t frame_start {0};
+    ProfileFrame last_frame;
+
+    int capture_remaining {0};
+    std::string capture_filename;
+    std::vector<CapturedEvent> captured;
+    // On the thread that ended each frame
+    std::vector<CapturedEvent> captured_frames;
+};
+
+static ProfilerState& state()
+{
+    static ProfilerState s;
+    return s;
+}
+
+static ThreadLog& threadLog()
+{
+    thread_local ThreadLog* log {nullptr};
+
+    if (log == nullptr)
+    {
+        ProfilerState& s {state()};
+        std::lock_guard<std::mutex> lock {s.mutex};
+
+        s.threads.push_back(std::make_unique<ThreadLog>());
+        log = s.threads.back().get();
+        log->tid = (uint32_t)s.threads.size() - 1;
+        log->name = "thread " + std::to_string(log->tid);
+        log->events.reserve(1024);
+    }
+
+    return *log;
+}
+
+uint64_t profileNow()
+{
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()
+    ).count();
+}
+
+void profileSetThreadName(const std::string& name)
+{
+    ThreadLog& log {threadLog()};
+
+    // Read by writeTrace under the same lock
+    std::lock_guard<std::mutex> lock {state().mutex};
+    log.name = name;
+}
+
+void profileRecord(const char* name, uint64_t start_ns, uint64_t end_ns)
+{
+    threadLog().events.push_back(ProfileEvent{name, start_ns, end_ns, false});
+}
+
+void profileCount(const char* name, int64_t value)
+{
+    threadLog().events.push_back(ProfileEvent{name, profileNow(), (uint64_t)value, true});
+}
+
+void profileBeginFrame()
+{
+    state().frame_start = profileNow();
+}
+
+static bool sameName(const char* a, const char* b)
+{
+    return a == b || std::strcmp(a, b) == 0;
+}
+
+static void writeTrace(ProfilerState& s)
+{
+    std::FILE* file {std::fopen(s.capture_filename.c_str(), "w")};
+    if (file == nullptr)
+    {
+        SDL_Log("Could not create trace file %s", s.capture_filename.c_str());
+        return;
+    }
+
+    uint64_t origin {s.captured_frames.empty() ? 0 : s.captured_frames.front().event.start};
+    auto micros = [origin](uint64_t ns) {
+        return (double)(ns - origin) / 1000.0;
+    };
+
+    std::fprintf(file, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n");
+
+    for (const std::unique_ptr<ThreadLog>& log : s.threads)
+    {
+        std::fprintf(file, "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": %u, \"args\": {\"name\": \"%s\"}},\n",
+            log->tid, log->name.c_str());
+    }
+
+    for (const CapturedEvent& frame : s.captured_frames)
+    {
+        std::fprintf(file, "{\"name\": \"frame\", \"ph\": \"X\", \"pid\": 1, \"tid\": %u, \"ts\": %.3f, \"dur\": %.3f},\n",
+            frame.tid, micros(frame.event.start), (double)(frame.event.end_or_value - frame.event.start) / 1000.0);
+    }
+
+    for (const CapturedEvent& c : s.captured)
+    {
+        if (c.event.counter)
+        {
+            std::fprintf(file, "{\"name\": \"%s\", \"ph\": \"C\", \"pid\": 1, \"tid\": %u, \"ts\": %.3f, \"args\": {\"value\": %lld}},\n",
+                c.event.name, c.tid, micros(c.event.start), (long long)(int64_t)c.event.end_or_value);
+        }
+        else
+        {
+            std::fprintf(file, "{\"name\": \"%s\", \"ph\": \"X\", \"pid\": 1, \"tid\": %u, \"ts\": %.3f, \"dur\": %.3f},\n",
+                c.event.name, c.tid, micros(c.event.start), (double)(c.event.end_or_value - c.event.start) / 1000.0);
+        }
+    }
+
+    // Trailing metadata event so every entry above can end with a comma
+    std::fprintf(file, "{\"name\": \"process_name\", \"ph\": \"M\", \"pid\": 1, \"args\": {\"name\": \"Rasterizer\"}}\n]}\n");
+    std::fclose(file);
+
+    SDL_Log("Wrote %zu frame trace to %s", s.captured_frames.size(), s.capture_filename.c_str());
+}
+
+void profileEndFrame()
+{
+    ProfilerState& s {state()};
+    uint64_t frame_end {profileNow()};
+    // Before the lock, which registering the thread would take again
+    uint32_t tid {threadLog().tid};
+
+    // Workers are idle between frames, so their logs can be drained here
+    std::lock_guard<std::mutex> lock {s.mutex};
+
+    ProfileFrame& frame {s.last_frame};
+    frame.frame_ms = (double)(frame_end - s.frame_start) / 1e6;
+    frame.zones.clear();
+    frame.counters.clear();
+
+    bool capturing {s.capture_remaining > 0};
+
+    for (const std::unique_ptr<ThreadLog>& log : s.threads)
+    {
+        for (const ProfileEvent& e : log->events)
+        {
+            if (e.counter)
+            {
+                auto it {std::find_if(frame.counters.begin(), frame.counters.end(), [&](const ProfileCounter& c) {return sameName(c.name, e.name);})};
+                if (it == frame.counters.end()) it = frame.counters.insert(it, ProfileCounter{e.name, 0});
+                it->value += (int64_t)e.end_or_value;
+            }
+            else
+            {
+                auto it {std::find_if(frame.zones.begin(), frame.zones.end(), [&](const ProfileZone& z) {return sameName(z.name, e.name);})};
+                if (it == frame.zones.end()) it = frame.zones.insert(it, ProfileZone{e.name, 0.0, 0});
+                it->total_ms += (double)(e.end_or_value - e.start) / 1e6;
+                ++it->calls;
+            }
+
+            if (capturing) s.captured.push_back(CapturedEvent{log->tid, e});
+        }
+
+        log->events.clear();
+    }
+
+    if (capturing)
+    {
+        s.captured_frames.push_back(CapturedEvent{tid, ProfileEvent{"frame", s.frame_start, frame_end, false}});
+
+        if (--s.capture_remaining == 0)
+        {
+            writeTrace(s);
+            s.captured.clear();
+            s.captured_frames.clear();
+        }
+    }
+}
+
+void profileStartCapture(int frame_count, const std::string& filename)
+{
+    ProfilerState& s {state()};
+    std::lock_guard<std::mutex> lock {s.mutex};
+
+    s.capture_remaining = frame_count;
+    s.capture_filename = filename;
+    s.captured.clear();
+    s.captured_frames.clear();
+}
+
+bool profileCapturing()
+{
+    ProfilerState& s {state()};
+    std::lock_guard<std::mutex> lock {s.mutex};
+    return s.capture_remaining > 0;
+}
+
+const ProfileFrame& profileLastFrame()
+{
+    return state().last_frame;
+}
+
+#endif
@@ -0,0 +1,345 @@
+#include "../include/raster.hpp"
+#include "../include/texture.hpp"
+
+#include <algorithm>
+
+struct FixedPoint2D
+{
+    int64_t x;
+    int64_t y;
+};
+
+static FixedPoint2D toFixed(const RasterVertex& v)
+{
+    return FixedPoint2D{
+        (int64_t)std::lround(v.x * RAST::SUBPIXEL_ONE),
+        (int64_t)std::lround(v.y * RAST::SUBPIXEL_ONE)
+    };
+}
+
+static int64_t orient2D(const FixedPoint2D& a, const FixedPoint2D& b, const FixedPoint2D& p)
+{
+    return (b.x - a.x) * (p.y - a.y) - (b.y - a.y) * (p.x - a.x);
+}
+
+static bool isTopLeft(const FixedPoint2D& a, const FixedPoint2D& b)
+{
+    // With y pointing down and positive area, the interior lies below top
+    // edges and to the right of left edges
+    int64_t dx {b.x - a.x};
+    int64_t dy {b.y - a.y};
+    return dy < 0 || (dy == 0 && dx > 0);
+}
+
+static bool inGuardBand(const RasterVertex& v)
+{
+    return (
+        v.x >= -RAST::GUARD_BAND && v.x <= RAST::GUARD_BAND &&
+        v.y >= -RAST::GUARD_BAND && v.y <= RAST::GUARD_BAND
+    );
+}
+
+void Framebuffer::clear(uint32_t c, float d)
+{
+    std::fill(color.begin(), color.end(), c);
+    std::fill(depth.begin(), depth.end(), d);
+}
+
+void Framebuffer::clear(const ScissorRect& rect, uint32_t c, float d)
+{
+    for (int y = rect.y0; y < rect.y1; ++y)
+    {
+        size_t offset {(size_t)y * width};
+        std::fill(color.begin() + offset + rect.x0, color.begin() + offset + rect.x1, c);
+        std::fill(depth.begin() + offset + rect.x0, depth.begin() + offset + rect.x1, d);
+    }
+}
+
+uint32_t packARGB(const ColorRGB& c)
+{
+    auto channel = [](float f) {
+        return (uint32_t)(std::clamp(f, 0.0f, 1.0f) * 255.0f + 0.5f);
+    };
+
+    return 0xFF000000u | channel(c.r()) << 16 | channel(c.g()) << 8 | channel(c.b());
+}
+
+// Scan of a counter-clockwise triangle; the untextured instance carries
+// none of the texturing work
+template <bool TEXTURED>
+static void fillTriangle(
+    Framebuffer& fb,
+    const RasterVertex* const v[3],
+    const FixedPoint2D p[3],
+    int64_t area,
+    const ScissorRect& scissor,
+    const RasterTexCoords* const tex[3],
+    const Texture* texture
+)
+{
+    // Pixel bounding box, clipped to the scissor rect
+    int min_x {(int)(std::min({p[0].x, p[1].x, p[2].x}) >> RAST::SUBPIXEL_BITS)};
+    int min_y {(int)(std::min({p[0].y, p[1].y, p[2].y}) >> RAST::SUBPIXEL_BITS)};
+    int max_x {(int)(std::max({p[0].x, p[1].x, p[2].x}) >> RAST::SUBPIXEL_BITS)};
+    int max_y {(int)(std::max({p[0].y, p[1].y, p[2].y}) >> RAST::SUBPIXEL_BITS)};
+
+    min_x = std::max(min_x, scissor.x0);
+    min_y = std::max(min_y, scissor.y0);
+    max_x = std::min(max_x, scissor.x1 - 1);
+    max_y = std::min(max_y, scissor.y1 - 1);
+
+    if (min_x > max_x || min_y > max_y) return;
+
+    // Edge i is opposite vertex i; non top-left edges exclude w == 0
+    int64_t bias[3] {
+        isTopLeft(p[1], p[2]) ? 0 : -1,
+        isTopLeft(p[2], p[0]) ? 0 : -1,
+        isTopLeft(p[0], p[1]) ? 0 : -1
+    };
+
+    // Per-pixel edge function steps
+    int64_t step_x[3] {
+        (p[1].y - p[2].y) * RAST::SUBPIXEL_ONE,
+        (p[2].y - p[0].y) * RAST::SUBPIXEL_ONE,
+        (p[0].y - p[1].y) * RAST::SUBPIXEL_ONE
+    };
+    int64_t step_y[3] {
+        (p[2].x - p[1].x) * RAST::SUBPIXEL_ONE,
+        (p[0].x - p[2].x) * RAST::SUBPIXEL_ONE,
+        (p[1].x - p[0].x) * RAST::SUBPIXEL_ONE
+    };
+
+    // Edge functions at the first pixel centre
+    FixedPoint2D origin {
+        ((int64_t)min_x << RAST::SUBPIXEL_BITS) + RAST::SUBPIXEL_ONE / 2,
+        ((int64_t)min_y << RAST::SUBPIXEL_BITS) + RAST::SUBPIXEL_ONE / 2
+    };
+    int64_t row[3] {
+        orient2D(p[1], p[2], origin) + bias[0],
+        orient2D(p[2], p[0], origin) + bias[1],
+        orient2D(p[0], p[1], origin) + bias[2]
+    };
+
+    float inv_area {1.0f / (float)area};
+    float dz1 {v[1]->depth - v[0]->depth};
+    float dz2 {v[2]->depth - v[0]->depth};
+    ColorRGB c0 {v[0]->color};
+    ColorRGB c1 {v[1]->color};
+    ColorRGB c2 {v[2]->color};
+    ColorRGB dc1 {c1 - c0};
+    ColorRGB dc2 {c2 - c0};
+
+    // 1/w and u/w, v/w are affine in screen space, so their per-pixel
+    // gradients are constant over the triangle
+    RasterTexCoords t0 {};
+    float dw1 {0.0f}, dw2 {0.0f};
+    float du1 {0.0f}, du2 {0.0f};
+    float dv1 {0.0f}, dv2 {0.0f};
+    if constexpr (TEXTURED)
+    {
+        t0 = *tex[0];
+        dw1 = tex[1]->inv_w - t0.inv_w;
+        dw2 = tex[2]->inv_w - t0.inv_w;
+        du1 = tex[1]->u_w - t0.u_w;
+        du2 = tex[2]->u_w - t0.u_w;
+        dv1 = tex[1]->v_w - t0.v_w;
+        dv2 = tex[2]->v_w - t0.v_w;
+    }
+
+    float dl1_dx {(float)step_x[1] * inv_area};
+    float dl2_dx {(float)step_x[2] * inv_area};
+    float dl1_dy {(float)step_y[1] * inv_area};
+    float dl2_dy {(float)step_y[2] * inv_area};
+
+    float dw_dx {dw1 * dl1_dx + dw2 * dl2_dx};
+    float dw_dy {dw1 * dl1_dy + dw2 * dl2_dy};
+    float du_dx {du1 * dl1_dx + du2 * dl2_dx};
+    float du_dy {du1 * dl1_dy + du2 * dl2_dy};
+    float dv_dx {dv1 * dl1_dx + dv2 * dl2_dx};
+    float dv_dy {dv1 * dl1_dy + dv2 * dl2_dy};
+
+    float texture_width {TEXTURED ? (float)texture->width() : 0.0f};
+    float texture_height {TEXTURED ? (float)texture->height() : 0.0f};
+
+    for (int y = min_y; y <= max_y; ++y)
+    {
+        int64_t w[3] {row[0], row[1], row[2]};
+        size_t offset {(size_t)y * fb.width};
+
+        for (int x = min_x; x <= max_x; ++x)
+        {
+            if ((w[0] | w[1] | w[2]) >= 0)
+            {
+                // Undo the fill-rule bias before interpolating
+                float l1 {(float)(w[1] - bias[1]) * inv_area};
+                float l2 {(float)(w[2] - bias[2]) * inv_area};
+                float z {v[0]->depth + l1 * dz1 + l2 * dz2};
+
+                if (z < fb.depth[offset + x])
+                {
+                    fb.depth[offset + x] = z;
+                    ColorRGB color {c0 + dc1 * l1 + dc2 * l2};
+
+                    if constexpr (TEXTURED)
+                    {
+                        float inv_w {t0.inv_w + l1 * dw1 + l2 * dw2};
+                        float w_pixel {1.0f / inv_w};
+                        float s {(t0.u_w + l1 * du1 + l2 * du2) * w_pixel};
+                        float t {(t0.v_w + l1 * dv1 + l2 * dv2) * w_pixel};
+
+                        // Derivatives of s = (u/w) / (1/w) by the quotient rule, in texels
+                        float sx {(du_dx - s * dw_dx) * w_pixel * texture_width};
+                        float tx {(dv_dx - t * dw_dx) * w_pixel * texture_height};
+                        float sy {(du_dy - s * dw_dy) * w_pixel * texture_width};
+                        float ty {(dv_dy - t * dw_dy) * w_pixel * texture_height};
+                        float rho2 {std::max(sx * sx + tx * tx, sy * sy + ty * ty)};
+
+                        ColorRGB texel {texture->sample(s, t, texture->selectLevel(rho2))};
+                        color = ColorRGB(color.r() * texel.r(), color.g() * texel.g(), color.b() * texel.b());
+                    }
+
+                    fb.color[offset + x] = packARGB(color);
+                }
+            }
+
+            w[0] += step_x[0];
+            w[1] += step_x[1];
+            w[2] += step_x[2];
+        }
+
+        row[0] += step_y[0];
+        row[1] += step_y[1];
+        row[2] += step_y[2];
+    }
+}
+
+void rasterizeTriangle(
+    Framebuffer& fb,
+    const RasterVertex& v1,
+    const RasterVertex& v2,
+    const RasterVertex& v3,
+    const ScissorRect& scissor,
+    const TexturedTriangle* textured
+)
+{
+    if (!inGuardBand(v1) || !inGuardBand(v2) || !inGuardBand(v3)) return;
+
+    const RasterVertex* v[3] {&v1, &v2, &v3};
+    const RasterTexCoords* tex[3] {nullptr, nullptr, nullptr};
+    if (textured)
+    {
+        tex[0] = &textured->t[0];
+        tex[1] = &textured->t[1];
+        tex[2] = &textured->t[2];
+    }
+    FixedPoint2D p[3] {toFixed(v1), toFixed(v2), toFixed(v3)};
+
+    int64_t area {orient2D(p[0], p[1], p[2])};
+    if (area == 0) return;
+
+    // Both windings are drawn, so flip clockwise triangles
+    if (area < 0)
+    {
+        std::swap(p[1], p[2]);
+        std::swap(v[1], v[2]);
+        std::swap(tex[1], tex[2]);
+        area = -area;
+    }
+
+    if (textured)
+    {
+        fillTriangle<true>(fb, v, p, area, scissor, tex, textured->texture);
+    }
+    else
+    {
+        fillTriangle<false>(fb, v, p, area, scissor, tex, nullptr);
+    }
+}
+
+TileBinner::TileBinner(int width, int height)
+: m_width(width),
+  m_height(height),
+  m_tiles_x((width + RAST::TILE_SIZE - 1) / RAST::TILE_SIZE),
+  m_tiles_y((height + RAST::TILE_SIZE - 1) / RAST::TILE_SIZE),
+  m_offsets(m_tiles_x * m_tiles_y + 1, 0)
+{
+}
+
+ScissorRect TileBinner::tileRect(int tile) const
+{
+    int x0 {(tile % m_tiles_x) * RAST::TILE_SIZE};
+    int y0 {(tile / m_tiles_x) * RAST::TILE_SIZE};
+
+    return ScissorRect{
+        x0,
+        y0,
+        std::min(x0 + RAST::TILE_SIZE, m_width),
+        std::min(y0 + RAST::TILE_SIZE, m_height)
+    };
+}
+
+void TileBinner::bin(std::span<const RasterTriangle> triangles, FrameArena& arena)
+{
+    // Tile range of every triangle; empty when it is skipped
+    struct TileRange
+    {
+        int16_t x0, y0, x1, y1;
+    };
+
+    FrameVector<TileRange> ranges {ArenaAllocator<TileRange>(arena)};
+    ranges.resize(triangles.size());
+    std::fill(m_offsets.begin(), m_offsets.end(), 0);
+
+    for (size_t i = 0; i < triangles.size(); ++i)
+    {
+        ranges[i] = TileRange{0, 0, -1, -1};
+
+        const RasterVertex* v {triangles[i].v};
+        if (!inGuardBand(v[0]) || !inGuardBand(v[1]) || !inGuardBand(v[2])) continue;
+
+        float min_x {std::min({v[0].x, v[1].x, v[2].x})};
+        float min_y {std::min({v[0].y, v[1].y, v[2].y})};
+        float max_x {std::max({v[0].x, v[1].x, v[2].x})};
+        float max_y {std::max({v[0].y, v[1].y, v[2].y})};
+
+        if (max_x < 0.0f || max_y < 0.0f || min_x >= m_width || min_y >= m_height) continue;
+
+        TileRange r {
+            (int16_t)(std::max((int)min_x, 0) / RAST::TILE_SIZE),
+            (int16_t)(std::max((int)min_y, 0) / RAST::TILE_SIZE),
+            (int16_t)(std::min((int)max_x, m_width - 1) / RAST::TILE_SIZE),
+            (int16_t)(std::min((int)max_y, m_height - 1) / RAST::TILE_SIZE)
+        };
+        ranges[i] = r;
+
+        for (int ty = r.y0; ty <= r.y1; ++ty)
+        {
+            for (int tx = r.x0; tx <= r.x1; ++tx)
+            {
+                ++m_offsets[ty * m_tiles_x + tx + 1];
+            }
+        }
+    }
+
+    // Counts to start offsets, then fill; each bin keeps submission order,
+    // so equal-depth ties resolve as before
+    for (size_t t = 1; t < m_offsets.size(); ++t)
+    {
+        m_offsets[t] += m_offsets[t - 1];
+    }
+
+    m_entries = static_cast<uint32_t*>(arena.allocate(m_offsets.back() * sizeof(uint32_t), alignof(uint32_t)));
+
+    FrameVector<uint32_t> cursor {m_offsets.begin(), m_offsets.end() - 1, ArenaAllocator<uint32_t>(arena)};
+    for (size_t i = 0; i < triangles.size(); ++i)
+    {
+        const TileRange& r {ranges[i]};
+        for (int ty = r.y0; ty <= r.y1; ++ty)
+        {
+            for (int tx = r.x0; tx <= r.x1; ++tx)
+            {
+                m_entries[cursor[ty * m_tiles_x + tx]++] = (uint32_t)i;
+            }
+        }
+    }
+}
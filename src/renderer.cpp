@@ -1,9 +1,27 @@
 #include "../include/renderer.hpp"
+#include "../include/scene.hpp"
 
-SDL_Vertex getSDLVertex(const PointNDC& point)
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <limits>
+
+using StageClock = std::chrono::steady_clock;
+
+static double elapsedMs(StageClock::time_point start)
 {
-    float x_screen {((point.x() + 1.0f) / 2.0f) * RAST::SCREEN_WIDTH};
-    float y_screen {(1.0f - (1.0f + point.y()) * 0.5f) * RAST::SCREEN_HEIGHT};
+    return std::chrono::duration<double, std::milli>(StageClock::now() - start).count();
+}
+
+static uint64_t elapsedNs(StageClock::time_point start)
+{
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(StageClock::now() - start).count();
+}
+
+SDL_Vertex getSDLVertex(const PointNDC& point, int width, int height)
+{
+    float x_screen {((point.x() + 1.0f) / 2.0f) * width};
+    float y_screen {(1.0f - (1.0f + point.y()) * 0.5f) * height};
 
     return SDL_Vertex{
         {x_screen, y_screen},
@@ -16,113 +34,1092 @@ SDL_Vertex getSDLVertex(const PointNDC& point)
     };
 }
 
-bool Renderer::inFrustrum(const Vertex& v, const CachedCamera& c)
+RasterVertex getRasterVertex(const PointNDC& point, float depth, int width, int height)
+{
+    float x_screen {((point.x() + 1.0f) / 2.0f) * width};
+    float y_screen {(1.0f - (1.0f + point.y()) * 0.5f) * height};
+
+    return RasterVertex{x_screen, y_screen, depth, point.color};
+}
+
+// Maps the placeholder cube onto an object-space box
+static Matrix4x4 placeholderMatrix(const AABB& box)
+{
+    Vector3 box_min {box.min};
+    Vector3 box_max {box.max};
+    Vector3 center {(box_min + box_max) * 0.5f};
+    Vector3 half {(box_max - box_min) * 0.5f};
+
+    return Matrix4x4{
+        {half.x(), 0, 0, center.x()},
+        {0, half.y(), 0, center.y()},
+        {0, 0, half.z(), center.z()},
+        {0, 0, 0, 1}
+    };
+}
+
+// Screen pixels spanned by one object-space unit at the point of the
+// bounding sphere nearest the eye
+static float pixelsPerUnit(const Bounds& bounds, const Matrix4x4& model, const Vector3& scale, const CachedCamera& c, int height)
 {
-    return (
-        v.pos.z() <= -c.near_plane && v.pos.z() >= -c.far_plane
-    );
-};
+    const BoundingSphere& sphere {bounds.sphere};
+    Matrix4x4 view {c.view_matrix};
+    Vector3 center {view.MatMult(model).MatMult(sphere.center)};
+    float max_scale {std::max({std::abs(scale.x()), std::abs(scale.y()), std::abs(scale.z())})};
+    float distance {std::max(center.magnitude() - sphere.radius * max_scale, c.near_plane)};
 
-bool Renderer::inScreen(const PointNDC& p)
+    return max_scale * c.y_scale * 0.5f * (float)height / distance;
+}
+
+Renderer::Renderer(SDL_Window* w, SDL_Renderer* r, Camera* c, RenderBackend backend)
+: m_renderer(r), camera(c), m_width(0), m_height(0), m_backend(backend), m_framebuffer(0, 0), m_binner(0, 0),
+  m_jobs(std::make_unique<JobSystem>(m_arena))
 {
-    return (
-        p.x() >= -1.0f && p.x() <= 1.0f &&
-        p.y() >= -1.0f && p.y() <= 1.0f
-    );
+    SDL_GetWindowSize(w, &m_width, &m_height);
+    rebindToArena(m_triangles, m_arena);
+    m_work.rebind(m_arena);
+
+    if (m_backend == RenderBackend::Software)
+    {
+        m_framebuffer = Framebuffer(m_width, m_height);
+        m_present_color.resize(m_framebuffer.color.size());
+        m_binner = TileBinner(m_width, m_height);
+        m_frame_texture = SDL_CreateTexture(
+            m_renderer,
+            SDL_PIXELFORMAT_ARGB8888,
+            SDL_TEXTUREACCESS_STREAMING,
+            m_width,
+            m_height
+        );
+
+        if (m_frame_texture == nullptr)
+        {
+            SDL_Log("Could not create frame texture! SDL error: %s\n", SDL_GetError());
+        }
+    }
+}
+
+Renderer::Renderer(int width, int height, Camera* c)
+: m_renderer(nullptr), camera(c), m_width(width), m_height(height), m_backend(RenderBackend::Software),
+  m_framebuffer(width, height), m_binner(width, height), m_jobs(std::make_unique<JobSystem>(m_arena))
+{
+    rebindToArena(m_triangles, m_arena);
+    m_work.rebind(m_arena);
+}
+
+Renderer::~Renderer()
+{
+    if (m_frame_texture != nullptr)
+    {
+        SDL_DestroyTexture(m_frame_texture);
+    }
+}
+
+void Renderer::BeginFrame()
+{
+    profileBeginFrame();
+    m_jobs->beginFrame();
+
+    // The buffers let go of last frame's storage while it is still valid,
+    // then the arena takes all of it back at once
+    rebindToArena(m_triangles, m_arena);
+    m_work.rebind(m_arena);
+    for (const std::unique_ptr<MeshWork>& w : m_object_work)
+    {
+        w->rebind(m_arena);
+    }
+    m_arena.reset();
+
+    // Software tiles clear themselves while rasterizing
+    if (m_backend != RenderBackend::Software)
+    {
+        SDL_SetRenderDrawColor(m_renderer, 0, 0, 0, 255);
+        SDL_RenderClear(m_renderer);
+    }
+}
+
+void Renderer::EndFrame()
+{
+    if (m_backend == RenderBackend::Software)
+    {
+        rasterizeTiles();
+    }
+
+    // Headless frames stay in the framebuffer for the caller to read
+    if (m_renderer == nullptr)
+    {
+        closeFrame();
+        return;
+    }
+
+    publishFrame();
+
+    {
+        RAST_PROFILE_SCOPE("present");
+        Present();
+    }
+
+    closeFrame();
+}
+
+void Renderer::FinishFrame()
+{
+    if (m_backend == RenderBackend::Software)
+    {
+        rasterizeTiles();
+    }
+
+    if (m_renderer != nullptr)
+    {
+        publishFrame();
+    }
+
+    closeFrame();
+}
+
+void Renderer::closeFrame()
+{
+    // Present usually runs on the thread owning the window, which has no
+    // profiler zones of its own; its time is collected here instead
+    uint64_t present_ns {m_present_ns.exchange(0, std::memory_order_relaxed)};
+    m_stats.present_ms += present_ns / 1e6;
+    RAST_PROFILE_COUNT("present.us", present_ns / 1000);
+
+    RAST_PROFILE_COUNT("arena.bytes", m_arena.used());
+    m_jobs->endFrame();
+    profileEndFrame();
+}
+
+void Renderer::publishFrame()
+{
+    // Formatted here, on the rendering thread, where the reports are written
+    m_overlay_build.clear();
+    if (m_profile_overlay)
+    {
+        formatProfileOverlay();
+    }
+
+    // Swapping hands the finished colors over without a copy; every tile
+    // clears itself, so the buffer swapped in needs no reset
+    std::lock_guard<std::mutex> lock {m_present_mutex};
+    if (m_backend == RenderBackend::Software)
+    {
+        m_framebuffer.color.swap(m_present_color);
+        m_frame_fresh = true;
+    }
+    m_overlay_lines.swap(m_overlay_build);
+}
+
+void Renderer::Present()
+{
+    if (m_renderer == nullptr) return;
+
+    StageClock::time_point start {StageClock::now()};
+
+    {
+        std::lock_guard<std::mutex> lock {m_present_mutex};
+
+        if (m_backend == RenderBackend::Software)
+        {
+            // Single upload of the whole frame, once per published frame
+            if (m_frame_fresh)
+            {
+                SDL_UpdateTexture(
+                    m_frame_texture,
+                    nullptr,
+                    m_present_color.data(),
+                    m_width * (int)sizeof(uint32_t)
+                );
+                m_frame_fresh = false;
+            }
+            SDL_RenderTexture(m_renderer, m_frame_texture, nullptr, nullptr);
+        }
+
+        if (!m_overlay_lines.empty())
+        {
+            // SDL's debug font is 8 px tall
+            SDL_SetRenderDrawColor(m_renderer, 255, 255, 255, 255);
+            for (size_t i = 0; i < m_overlay_lines.size(); ++i)
+            {
+                SDL_RenderDebugText(m_renderer, 4.0f, 4.0f + 10.0f * (float)i, m_overlay_lines[i].c_str());
+            }
+        }
+    }
+
+    // Outside the lock: with vsync this blocks, and the renderer must not wait on it
+    SDL_RenderPresent(m_renderer);
+
+    m_present_ns.fetch_add(elapsedNs(start), std::memory_order_relaxed);
+}
+
+void Renderer::formatProfileOverlay()
+{
+    const ProfileFrame& frame {profileLastFrame()};
+    char line[96];
+
+    auto print = [&](const char* text) {
+        m_overlay_build.emplace_back(text);
+    };
+
+    std::snprintf(line, sizeof(line), "frame %.2f ms", frame.frame_ms);
+    print(line);
+
+    for (const ProfileZone& zone : frame.zones)
+    {
+        std::snprintf(line, sizeof(line), "%-20s %7.3f ms x%u", zone.name, zone.total_ms, zone.calls);
+        print(line);
+    }
+
+    for (const ProfileCounter& counter : frame.counters)
+    {
+        std::snprintf(line, sizeof(line), "%-20s %lld", counter.name, (long long)counter.value);
+        print(line);
+    }
+
+    // Previous frame's worker activity; this one is still running
+    const JobReport& jobs {m_jobs->report()};
+    for (size_t i = 0; i < jobs.workers.size(); ++i)
+    {
+        const WorkerReport& worker {jobs.workers[i]};
+        std::snprintf(line, sizeof(line), "worker %-2zu %5.1f%% busy %7.3f ms idle %4u jobs %3u steals",
+            i, jobs.utilization(i) * 100.0, jobs.idleMs(i), worker.jobs, worker.steals);
+        print(line);
+    }
 }
 
 CachedCamera Renderer::cacheCamera()
 {
+    float aspect_ratio {(float)m_width / (float)m_height};
+    float f {1.0f / std::tan(camera->fov * 0.5f * PI / 180.0f)};
+
+    Matrix4x4 view {camera->viewMatrix()};
+    Matrix4x4 projection {perspectiveMatrix(camera->fov, aspect_ratio, camera->near_plane, camera->far_plane)};
+
     return CachedCamera{
         camera->far_plane,
         camera->near_plane,
         camera->fov,
-        camera->viewMatrix()
+        view,
+        camera->frustumPlanes(),
+        f / aspect_ratio,
+        f,
+        projection.MatMult(view),
+        // NDC extent of the guard band, with a margin for rounding
+        (2.0f * RAST::GUARD_BAND / m_width - 1.0f) * 0.99f,
+        (2.0f * RAST::GUARD_BAND / m_height - 1.0f) * 0.99f
     };
 }
 
-PointNDC Renderer::getNDC(const Vertex& point, const CachedCamera& c)
+static uint8_t computeOutcode(const ClipVertex& v, const CachedCamera& c)
 {
-    float aspect_ratio {(float)m_width / (float)m_height};
+    uint8_t code {0};
 
-    float f = 1.0f / std::tan(c.fov * 0.5f * PI / 180.0f);
-    float x_ndc {point.pos.x() / point.pos.z() * f / aspect_ratio};
-    float y_ndc {point.pos.y() / point.pos.z() * f};
+    if (v.z < 0.0f) code |= RAST::CLIP_NEAR;
+    if (v.z > v.w) code |= RAST::CLIP_FAR;
+    if (v.x < -v.w) code |= RAST::CLIP_LEFT;
+    if (v.x > v.w) code |= RAST::CLIP_RIGHT;
+    if (v.y < -v.w) code |= RAST::CLIP_BOTTOM;
+    if (v.y > v.w) code |= RAST::CLIP_TOP;
+    if (std::abs(v.x) > c.guard_x * v.w || std::abs(v.y) > c.guard_y * v.w) code |= RAST::CLIP_GUARD;
 
-    return PointNDC(Vector2(x_ndc, y_ndc), point.color);
-};
+    return code;
+}
 
-void Renderer::Rendermesh(const Mesh& m)
+// Only called for vertices with w >= near > 0
+static PointNDC toNDC(const ClipVertex& v)
 {
-    CachedCamera cam_data {cacheCamera()};
-    
-    for (int i = 0; i < getMeshLength(m); ++i)
+    float inv_w {1.0f / v.w};
+    return PointNDC(Vector2(v.x * inv_w, v.y * inv_w), v.color);
+}
+
+static RasterTexCoords toRasterTexCoords(const ClipVertex& v, const Vector2& uv)
+{
+    float inv_w {1.0f / v.w};
+    return RasterTexCoords{inv_w, uv.x() * inv_w, uv.y() * inv_w};
+}
+
+template <typename MeshType>
+void Renderer::prepareWork(const MeshType& m, MeshWork& w)
+{
+    w.vertex_count = getVertexCount(m);
+    w.triangle_count = (size_t)getMeshLength(m);
+    w.vertex_chunks = (w.vertex_count + RAST::VERTEX_CHUNK - 1) / RAST::VERTEX_CHUNK;
+    w.slot_count = (w.triangle_count + RAST::SETUP_CHUNK - 1) / RAST::SETUP_CHUNK;
+
+    w.processed.resize(w.vertex_count);
+    w.clip.resize(w.vertex_count);
+
+    if (m_backend == RenderBackend::Software)
     {
-        Vertex v1 {m.vertices[m.indices[i * 3 + 0]]};
-        Vertex v2 {m.vertices[m.indices[i * 3 + 1]]};
-        Vertex v3 {m.vertices[m.indices[i * 3 + 2]]};
+        w.raster_vertices.resize(w.vertex_count);
+    }
+    else
+    {
+        w.sdl_vertices.resize(w.vertex_count);
+    }
 
-        // Global to camera transform
-        v1.pos = cam_data.view_matrix.MatMult(v1.pos);
-        v2.pos = cam_data.view_matrix.MatMult(v2.pos);
-        v3.pos = cam_data.view_matrix.MatMult(v3.pos);
+    // SDL_RenderGeometry is given no texture, so only the software backend samples one
+    w.texture = m_backend == RenderBackend::Software ? getTexture(m) : nullptr;
+    if (w.texture)
+    {
+        w.uv.resize(w.vertex_count);
+        w.raster_uv.resize(w.vertex_count);
+    }
 
-        // Frustrum cull
-        if (!inFrustrum(v1, cam_data) && !inFrustrum(v2, cam_data) && !inFrustrum(v3, cam_data)) continue;
+    if (w.slots.size() < w.slot_count)
+    {
+        size_t first {w.slots.size()};
+        w.slots.resize(w.slot_count);
+        for (size_t s = first; s < w.slot_count; ++s)
+        {
+            w.slots[s].rebind(m_arena);
+        }
+    }
+
+    w.vertex_ns = 0;
+    w.setup_ns = 0;
+}
+
+template <typename MeshType>
+void Renderer::transformVertices(const MeshType& m, const Matrix4x4& mvp, const CachedCamera& c, MeshWork& w, size_t chunk) const
+{
+    StageClock::time_point start {StageClock::now()};
+    size_t begin {chunk * RAST::VERTEX_CHUNK};
+    size_t end {std::min(begin + RAST::VERTEX_CHUNK, w.vertex_count)};
+    Vector4Stream clip {w.clip.stream()};
+
+    {
+        // Local to clip space, one batched multiply per vertex
+        RAST_PROFILE_SCOPE("vertex.transform");
+        mvp.MatMult(getPointStream(m), begin, end, clip);
+    }
+
+    // Outcodes, perspective divide and viewport per vertex
+    RAST_PROFILE_SCOPE("vertex.project");
+
+    for (size_t i = begin; i < end; ++i)
+    {
+        ProcessedVertex& p {w.processed[i]};
 
-        // NDC conversion
-        PointNDC p1 {getNDC(v1, cam_data)};
-        PointNDC p2 {getNDC(v2, cam_data)};
-        PointNDC p3 {getNDC(v3, cam_data)};
+        p.clip = {clip.x[i], clip.y[i], clip.z[i], clip.w[i], getVertexColor(m, i)};
+        p.outcode = computeOutcode(p.clip, c);
 
-        // Cull triangles fully offscreen
-        if (!inScreen(p1) && !inScreen(p2) && !inScreen(p3)) continue;
+        if (w.texture) w.uv[i] = getVertexUV(m, i);
+
+        // Behind the near plane there is nothing to divide; clipping makes new vertices
+        if (p.outcode & RAST::CLIP_NEAR) continue;
+
+        PointNDC ndc {toNDC(p.clip)};
 
         // Viewport transform
-        SDL_Vertex vertices[] = {getSDLVertex(p1), getSDLVertex(p2), getSDLVertex(p3)};
+        if (m_backend == RenderBackend::Software)
+        {
+            w.raster_vertices[i] = getRasterVertex(ndc, p.clip.z / p.clip.w, m_width, m_height);
+            if (w.texture) w.raster_uv[i] = toRasterTexCoords(p.clip, w.uv[i]);
+        }
+        else
+        {
+            w.sdl_vertices[i] = getSDLVertex(ndc, m_width, m_height);
+        }
+    }
+
+    w.vertex_ns += elapsedNs(start);
+}
 
-        // Render
-        SDL_RenderGeometry(m_renderer, nullptr, vertices, 3, nullptr, 0);
+int Renderer::emitVertex(const ClipVertex& v, const Vector2* uv, SetupSlot& slot) const
+{
+    PointNDC ndc {toNDC(v)};
+
+    if (m_backend == RenderBackend::Software)
+    {
+        slot.raster_vertices.push_back(getRasterVertex(ndc, v.z / v.w, m_width, m_height));
+        if (uv) slot.raster_uv.push_back(toRasterTexCoords(v, *uv));
+        return -(int)slot.raster_vertices.size();
     }
+
+    slot.sdl_vertices.push_back(getSDLVertex(ndc, m_width, m_height));
+    return -(int)slot.sdl_vertices.size();
 }
 
-void Renderer::RenderObject(const Renderable& r)
+static float clipDistance(const ClipVertex& v, int plane, const CachedCamera& c)
+{
+    switch (plane)
+    {
+        case 0: return v.z;
+        case 1: return v.x + c.guard_x * v.w;
+        case 2: return c.guard_x * v.w - v.x;
+        case 3: return v.y + c.guard_y * v.w;
+        default: return c.guard_y * v.w - v.y;
+    }
+}
+
+static ClipVertex lerpClip(const ClipVertex& a, const ClipVertex& b, float t)
+{
+    ColorRGB ca {a.color};
+    ColorRGB cb {b.color};
+
+    return ClipVertex{
+        a.x + (b.x - a.x) * t,
+        a.y + (b.y - a.y) * t,
+        a.z + (b.z - a.z) * t,
+        a.w + (b.w - a.w) * t,
+        ca + (cb - ca) * t
+    };
+}
+
+void Renderer::clipTriangle(
+    const MeshWork& w, uint32_t i1, uint32_t i2, uint32_t i3, uint8_t outcodes, const CachedCamera& c, SetupSlot& slot
+) const
+{
+    // Each plane adds at most one vertex: 3 + 5 planes
+    struct PolygonVertex
+    {
+        ClipVertex v;
+        Vector2 uv;     // Interpolated like the clip attributes; unused when untextured
+        int64_t index;  // Mesh vertex, or NEW_VERTEX until emitted
+    };
+
+    constexpr int64_t NEW_VERTEX {std::numeric_limits<int64_t>::min()};
+
+    PolygonVertex buffers[2][8];
+    PolygonVertex* in {buffers[0]};
+    PolygonVertex* out {buffers[1]};
+    int count {3};
+
+    bool textured {w.texture != nullptr};
+    in[0] = {w.processed[i1].clip, textured ? w.uv[i1] : Vector2(), i1};
+    in[1] = {w.processed[i2].clip, textured ? w.uv[i2] : Vector2(), i2};
+    in[2] = {w.processed[i3].clip, textured ? w.uv[i3] : Vector2(), i3};
+
+    // Plane 0 is near; 1-4 are the guard band. New near-plane vertices can land
+    // outside the band, so the band planes always follow
+    int first_plane {(outcodes & RAST::CLIP_NEAR) ? 0 : 1};
+
+    for (int plane = first_plane; plane <= 4 && count >= 3; ++plane)
+    {
+        int out_count {0};
+
+        for (int k = 0; k < count; ++k)
+        {
+            const PolygonVertex& a {in[k]};
+            const PolygonVertex& b {in[(k + 1) % count]};
+            float da {clipDistance(a.v, plane, c)};
+            float db {clipDistance(b.v, plane, c)};
+
+            if (da >= 0.0f) out[out_count++] = a;
+            if ((da >= 0.0f) != (db >= 0.0f))
+            {
+                float t {da / (da - db)};
+                Vector2 uva {a.uv};
+                Vector2 uvb {b.uv};
+                out[out_count++] = {lerpClip(a.v, b.v, t), uva + (uvb - uva) * t, NEW_VERTEX};
+            }
+        }
+
+        std::swap(in, out);
+        count = out_count;
+    }
+
+    if (count < 3) return;
+
+    for (int k = 0; k < count; ++k)
+    {
+        if (in[k].index == NEW_VERTEX) in[k].index = emitVertex(in[k].v, textured ? &in[k].uv : nullptr, slot);
+    }
+
+    // Clipped polygons are convex, so a fan covers them
+    for (int k = 1; k + 1 < count; ++k)
+    {
+        slot.indices.push_back((int)in[0].index);
+        slot.indices.push_back((int)in[k].index);
+        slot.indices.push_back((int)in[k + 1].index);
+    }
+}
+
+
+template <typename MeshType>
+void Renderer::setupChunk(const MeshType& m, const CachedCamera& c, MeshWork& w, size_t s) const
+{
+    RAST_PROFILE_SCOPE("triangle.setup.chunk");
+    StageClock::time_point start {StageClock::now()};
+
+    SetupSlot& slot {w.slots[s]};
+    slot.indices.clear();
+    slot.raster_vertices.clear();
+    slot.raster_uv.clear();
+    slot.sdl_vertices.clear();
+    slot.culled_depth = 0;
+    slot.culled_offscreen = 0;
+    slot.clipped = 0;
+
+    size_t begin {s * RAST::SETUP_CHUNK};
+    size_t end {std::min(begin + RAST::SETUP_CHUNK, w.triangle_count)};
+
+    for (size_t i = begin; i < end; ++i)
+    {
+        uint32_t i1 {m.indices[i * 3 + 0]};
+        uint32_t i2 {m.indices[i * 3 + 1]};
+        uint32_t i3 {m.indices[i * 3 + 2]};
+
+        uint8_t o1 {w.processed[i1].outcode};
+        uint8_t o2 {w.processed[i2].outcode};
+        uint8_t o3 {w.processed[i3].outcode};
+
+        // All three vertices outside the same frustum plane
+        uint8_t shared {(uint8_t)(o1 & o2 & o3 & RAST::CLIP_FRUSTUM)};
+        if (shared != 0)
+        {
+            if (shared & (RAST::CLIP_NEAR | RAST::CLIP_FAR))
+            {
+                ++slot.culled_depth;
+            }
+            else
+            {
+                ++slot.culled_offscreen;
+            }
+            continue;
+        }
+
+        // Crossing the near plane or leaving the guard band: the rare slow path
+        uint8_t any {(uint8_t)(o1 | o2 | o3)};
+        if (any & (RAST::CLIP_NEAR | RAST::CLIP_GUARD))
+        {
+            ++slot.clipped;
+            clipTriangle(w, i1, i2, i3, any, c, slot);
+            continue;
+        }
+
+        slot.indices.push_back((int)i1);
+        slot.indices.push_back((int)i2);
+        slot.indices.push_back((int)i3);
+    }
+
+    w.setup_ns += elapsedNs(start);
+}
+
+void Renderer::mergeSetupSlots(MeshWork& w) const
+{
+    // Offsets in chunk order, so the result matches a serial pass. Clipped
+    // vertices are rare and appended here; copySlotIndices does the rest
+    size_t index_total {0};
+    size_t vertex_base {m_backend == RenderBackend::Software ? w.raster_vertices.size() : w.sdl_vertices.size()};
+
+    for (size_t s = 0; s < w.slot_count; ++s)
+    {
+        SetupSlot& slot {w.slots[s]};
+        slot.index_offset = index_total;
+        slot.vertex_base = vertex_base;
+        index_total += slot.indices.size();
+
+        if (m_backend == RenderBackend::Software)
+        {
+            w.raster_vertices.insert(w.raster_vertices.end(), slot.raster_vertices.begin(), slot.raster_vertices.end());
+            w.raster_uv.insert(w.raster_uv.end(), slot.raster_uv.begin(), slot.raster_uv.end());
+            vertex_base += slot.raster_vertices.size();
+        }
+        else
+        {
+            w.sdl_vertices.insert(w.sdl_vertices.end(), slot.sdl_vertices.begin(), slot.sdl_vertices.end());
+            vertex_base += slot.sdl_vertices.size();
+        }
+    }
+
+    w.indices.resize(index_total);
+}
+
+void Renderer::copySlotIndices(MeshWork& w, size_t s) const
+{
+    const SetupSlot& slot {w.slots[s]};
+    int* out {w.indices.data() + slot.index_offset};
+
+    for (size_t i = 0; i < slot.indices.size(); ++i)
+    {
+        int index {slot.indices[i]};
+        out[i] = index >= 0 ? index : (int)slot.vertex_base - index - 1;
+    }
+}
+
+void Renderer::writeTriangles(MeshWork& w, RasterTriangle* out) const
+{
+    if (w.texture)
+    {
+        // Fresh storage, as triangles queued by an earlier draw through the
+        // same work still point into the old one; the arena keeps it alive
+        w.textured = FrameVector<TexturedTriangle>(w.textured.get_allocator());
+        w.textured.resize(w.indices.size() / 3);
+    }
+
+    for (size_t i = 0; i < w.indices.size(); i += 3)
+    {
+        const TexturedTriangle* textured {nullptr};
+        if (w.texture)
+        {
+            TexturedTriangle& t {w.textured[i / 3]};
+            t = TexturedTriangle{{
+                w.raster_uv[w.indices[i + 0]],
+                w.raster_uv[w.indices[i + 1]],
+                w.raster_uv[w.indices[i + 2]]
+            }, w.texture};
+            textured = &t;
+        }
+
+        *out++ = RasterTriangle{{
+            w.raster_vertices[w.indices[i + 0]],
+            w.raster_vertices[w.indices[i + 1]],
+            w.raster_vertices[w.indices[i + 2]]
+        }, textured};
+    }
+}
+
+void Renderer::countWork(const MeshWork& w)
+{
+    size_t culled_depth {0};
+    size_t culled_offscreen {0};
+    size_t clipped {0};
+
+    for (size_t s = 0; s < w.slot_count; ++s)
+    {
+        culled_depth += w.slots[s].culled_depth;
+        culled_offscreen += w.slots[s].culled_offscreen;
+        clipped += w.slots[s].clipped;
+    }
+
+    m_stats.vertices_transformed += w.vertex_count;
+    m_stats.indices_processed += w.triangle_count * 3;
+    m_stats.triangles_submitted += w.indices.size() / 3;
+    m_stats.triangles_culled_depth += culled_depth;
+    m_stats.triangles_culled_offscreen += culled_offscreen;
+    m_stats.triangles_clipped += clipped;
+
+    RAST_PROFILE_COUNT("triangles.in", w.triangle_count);
+    RAST_PROFILE_COUNT("triangles.culled_depth", culled_depth);
+    RAST_PROFILE_COUNT("triangles.culled_screen", culled_offscreen);
+    RAST_PROFILE_COUNT("triangles.clipped", clipped);
+    RAST_PROFILE_COUNT("triangles.submitted", w.indices.size() / 3);
+}
+
+template <typename MeshType>
+void Renderer::processVertices(const MeshType& m, Matrix4x4 mvp, const CachedCamera& c)
+{
+    StageClock::time_point start {StageClock::now()};
+    prepareWork(m, m_work);
+
+    // Chunks own disjoint vertex ranges, so the outputs need no merge
+    m_jobs->parallelFor(m_work.vertex_chunks, [&](size_t chunk) {
+        transformVertices(m, mvp, c, m_work, chunk);
+    });
+
+    m_stats.vertex_ms += elapsedMs(start);
+}
+
+template <typename MeshType>
+void Renderer::setupTriangles(const MeshType& m, const CachedCamera& c)
+{
+    RAST_PROFILE_SCOPE("triangle.setup");
+    StageClock::time_point start {StageClock::now()};
+
+    // Each chunk culls and clips its own triangles into its own slot
+    m_jobs->parallelFor(m_work.slot_count, [&](size_t s) {
+        setupChunk(m, c, m_work, s);
+    });
+
+    mergeSetupSlots(m_work);
+    m_jobs->parallelFor(m_work.slot_count, [this](size_t s) {
+        copySlotIndices(m_work, s);
+    });
+
+    countWork(m_work);
+    m_stats.setup_ms += elapsedMs(start);
+}
+
+void Renderer::submitBatch(const MeshWork& w)
+{
+    RAST_PROFILE_SCOPE("submit.geometry");
+    StageClock::time_point start {StageClock::now()};
+
+    if (!w.indices.empty())
+    {
+        SDL_RenderGeometry(
+            m_renderer,
+            nullptr,
+            w.sdl_vertices.data(),
+            (int)w.sdl_vertices.size(),
+            w.indices.data(),
+            (int)w.indices.size()
+        );
+    }
+
+    m_stats.raster_ms += elapsedMs(start);
+}
+
+void Renderer::queueTriangles(MeshWork& w)
+{
+    RAST_PROFILE_SCOPE("triangle.queue");
+    StageClock::time_point start {StageClock::now()};
+
+    size_t base {m_triangles.size()};
+    m_triangles.resize(base + w.indices.size() / 3);
+    writeTriangles(w, m_triangles.data() + base);
+
+    m_stats.setup_ms += elapsedMs(start);
+}
+
+void Renderer::rasterizeTiles()
+{
+    StageClock::time_point start {StageClock::now()};
+    double bin_ms {0.0};
+
+    // Binning feeds every tile; each tile then owns a disjoint framebuffer
+    // region, so the tile jobs need no locks
+    Job* bin {m_jobs->add("raster.bin", [this, &bin_ms] {
+        StageClock::time_point bin_start {StageClock::now()};
+        m_binner.bin(m_triangles, m_arena);
+        bin_ms = elapsedMs(bin_start);
+    })};
+
+    for (int tile = 0; tile < m_binner.tileCount(); ++tile)
+    {
+        Job* raster {m_jobs->add("raster.tile", [this, tile] {
+            ScissorRect rect {m_binner.tileRect(tile)};
+            m_framebuffer.clear(rect, packARGB(ColorRGB(0, 0, 0)));
+
+            for (uint32_t t : m_binner.tileBin(tile))
+            {
+                const RasterTriangle& tri {m_triangles[t]};
+                rasterizeTriangle(m_framebuffer, tri.v[0], tri.v[1], tri.v[2], rect, tri.textured);
+            }
+        })};
+        m_jobs->precede(bin, raster);
+    }
+
+    m_jobs->run();
+
+    m_stats.bin_ms += bin_ms;
+    m_stats.raster_ms += elapsedMs(start) - bin_ms;
+}
+
+template <typename MeshType>
+void Renderer::renderMesh(const MeshType& m, Matrix4x4 mvp, const CachedCamera& c)
+{
+    processVertices(m, mvp, c);
+    setupTriangles(m, c);
+
+    if (m_backend == RenderBackend::Software)
+    {
+        queueTriangles(m_work);
+    }
+    else
+    {
+        submitBatch(m_work);
+    }
+}
+
+Job* Renderer::scheduleObject(const MeshView& m, const CachedCamera& c, MeshWork& w)
+{
+    prepareWork(m, w);
+
+    // vertex chunks -> (join) -> setup chunks -> finish; objects overlap freely
+    Job* vertices_done {m_jobs->add("object.vertices", [] {})};
+    Job* finish {m_jobs->add("object.finish", [this, &w] {
+        StageClock::time_point start {StageClock::now()};
+        mergeSetupSlots(w);
+        for (size_t s = 0; s < w.slot_count; ++s)
+        {
+            copySlotIndices(w, s);
+        }
+        w.setup_ns += elapsedNs(start);
+    })};
+
+    for (size_t chunk = 0; chunk < w.vertex_chunks; ++chunk)
+    {
+        Job* vertices {m_jobs->add("object.vertex_chunk", [this, &m, &c, &w, chunk] {
+            transformVertices(m, w.mvp, c, w, chunk);
+        })};
+        m_jobs->precede(vertices, vertices_done);
+    }
+
+    for (size_t s = 0; s < w.slot_count; ++s)
+    {
+        Job* setup {m_jobs->add("object.setup_chunk", [this, &m, &c, &w, s] {
+            setupChunk(m, c, w, s);
+        })};
+        m_jobs->precede(vertices_done, setup);
+        m_jobs->precede(setup, finish);
+    }
+
+    m_jobs->precede(vertices_done, finish);
+    return finish;
+}
+
+template <typename MeshType>
+void Renderer::renderObject(const BasicRenderable<MeshType>& r)
 {
     CachedCamera cam_data {cacheCamera()};
-    Matrix4x4 transform_matrix = r.transform.transformMatrix();
-    const auto& m = *r.mesh;
+    Matrix4x4 model {r.transform.transformMatrix()};
 
-    for (int i = 0; i < getMeshLength(m); ++i)
+    // Whole-object cull before any per-vertex work
+    if (!isVisible(getBounds(*r.mesh), model, cam_data.frustum))
     {
-        Vertex v1 {m.vertices[m.indices[i * 3 + 0]]};
-        Vertex v2 {m.vertices[m.indices[i * 3 + 1]]};
-        Vertex v3 {m.vertices[m.indices[i * 3 + 2]]};
+        ++m_stats.objects_culled;
+        RAST_PROFILE_COUNT("objects.culled", 1);
+        return;
+    }
 
-        // Local to global transform
-        v1.pos = transform_matrix.MatMult(v1.pos);
-        v2.pos = transform_matrix.MatMult(v2.pos);
-        v3.pos = transform_matrix.MatMult(v3.pos);
+    Matrix4x4 mvp {cam_data.view_projection.MatMult(model)};
+    renderMesh(*r.mesh, mvp, cam_data);
+}
 
-        // Global to camera transform
-        v1.pos = cam_data.view_matrix.MatMult(v1.pos);
-        v2.pos = cam_data.view_matrix.MatMult(v2.pos);
-        v3.pos = cam_data.view_matrix.MatMult(v3.pos);
+static Matrix4x4 instanceMatrix(const Transform& t)
+{
+    return t.transformMatrix();
+}
 
-        // Frustrum cull
-        if (!inFrustrum(v1, cam_data) && !inFrustrum(v2, cam_data) && !inFrustrum(v3, cam_data)) continue;
+static Matrix4x4 instanceMatrix(const Matrix4x4& m)
+{
+    return m;
+}
 
-        // NDC conversion
-        PointNDC p1 {getNDC(v1, cam_data)};
-        PointNDC p2 {getNDC(v2, cam_data)};
-        PointNDC p3 {getNDC(v3, cam_data)};
+void Renderer::appendInstanceBatch()
+{
+    // Rebase this instance's indices onto the shared vertex array
+    int base {(int)m_instance_vertices.size()};
 
-        // Cull triangles fully offscreen
-        if (!inScreen(p1) && !inScreen(p2) && !inScreen(p3)) continue;
+    m_instance_vertices.insert(m_instance_vertices.end(), m_work.sdl_vertices.begin(), m_work.sdl_vertices.end());
+    for (int i : m_work.indices)
+    {
+        m_instance_indices.push_back(base + i);
+    }
+}
 
-        // Viewport transform
-        SDL_Vertex vertices[] = {getSDLVertex(p1), getSDLVertex(p2), getSDLVertex(p3)};
+void Renderer::flushInstanceBatch()
+{
+    if (!m_instance_indices.empty())
+    {
+        RAST_PROFILE_SCOPE("submit.geometry");
+        StageClock::time_point start {StageClock::now()};
+        SDL_RenderGeometry(
+            m_renderer,
+            nullptr,
+            m_instance_vertices.data(),
+            (int)m_instance_vertices.size(),
+            m_instance_indices.data(),
+            (int)m_instance_indices.size()
+        );
+        m_stats.raster_ms += elapsedMs(start);
+    }
+
+    m_instance_vertices.clear();
+    m_instance_indices.clear();
+}
+
+template <typename MeshType, typename InstanceType>
+void Renderer::renderInstanced(const MeshType& m, std::span<const InstanceType> instances)
+{
+    CachedCamera cam_data {cacheCamera()};
+    const Bounds& bounds {getBounds(m)};
+
+    for (const InstanceType& instance : instances)
+    {
+        Matrix4x4 model {instanceMatrix(instance)};
+
+        if (!isVisible(bounds, model, cam_data.frustum))
+        {
+            ++m_stats.objects_culled;
+            RAST_PROFILE_COUNT("objects.culled", 1);
+            continue;
+        }
+
+        Matrix4x4 mvp {cam_data.view_projection.MatMult(model)};
+        processVertices(m, mvp, cam_data);
+        setupTriangles(m, cam_data);
+
+        if (m_backend == RenderBackend::Software)
+        {
+            queueTriangles(m_work);
+        }
+        else if (!m_work.indices.empty())
+        {
+            // SDL indexes with int, so flush before the shared array overflows
+            if (m_instance_vertices.size() + m_work.sdl_vertices.size() > (size_t)std::numeric_limits<int>::max())
+            {
+                flushInstanceBatch();
+            }
+            appendInstanceBatch();
+        }
+    }
+
+    if (m_backend == RenderBackend::SDLGeometry)
+    {
+        flushInstanceBatch();
+    }
+}
+
+void Renderer::Rendermesh(const Mesh& m)
+{
+    CachedCamera cam_data {cacheCamera()};
+    renderMesh(m, cam_data.view_projection, cam_data);
+}
+
+void Renderer::Rendermesh(const MeshSoA& m)
+{
+    CachedCamera cam_data {cacheCamera()};
+    renderMesh(m, cam_data.view_projection, cam_data);
+}
+
+void Renderer::Rendermesh(const MeshView& m)
+{
+    CachedCamera cam_data {cacheCamera()};
+    renderMesh(m, cam_data.view_projection, cam_data);
+}
+
+void Renderer::RenderObject(const Renderable& r)
+{
+    renderObject(r);
+}
+
+void Renderer::RenderObject(const RenderableSoA& r)
+{
+    renderObject(r);
+}
+
+void Renderer::RenderObject(const RenderableView& r)
+{
+    renderObject(r);
+}
+
+void Renderer::RenderScene(Scene& scene)
+{
+    CachedCamera cam_data {cacheCamera()};
+    double cull_ms {0.0};
+
+    // Frame-wide triangle order follows the visible list, as in a serial pass
+    Job* merge {m_jobs->add("scene.merge", [this] {
+        if (m_backend != RenderBackend::Software) return;
+
+        size_t offset {m_triangles.size()};
+        for (size_t k = 0; k < m_visible.size(); ++k)
+        {
+            m_object_work[k]->triangle_offset = offset;
+            offset += m_object_work[k]->indices.size() / 3;
+        }
+        m_triangles.resize(offset);
+
+        // Disjoint ranges, so every object writes its own in parallel
+        for (size_t k = 0; k < m_visible.size(); ++k)
+        {
+            MeshWork& w {*m_object_work[k]};
+            m_jobs->add("object.queue", [this, &w] {
+                StageClock::time_point start {StageClock::now()};
+                writeTriangles(w, m_triangles.data() + w.triangle_offset);
+                w.setup_ns += elapsedNs(start);
+            });
+        }
+    })};
+
+    // The cull job spawns each visible object's jobs, so culling, vertex
+    // processing and setup of different objects overlap on the workers
+    Job* cull {m_jobs->add("scene.cull", [&] {
+        StageClock::time_point start {StageClock::now()};
+        m_visible.clear();
+        m_visible.reserve(scene.size());
+        scene.cull(cam_data.frustum, m_visible);
+        cull_ms = elapsedMs(start);
+
+        while (m_object_work.size() < m_visible.size())
+        {
+            m_object_work.push_back(std::make_unique<MeshWork>());
+            m_object_work.back()->rebind(m_arena);
+        }
+
+        for (size_t k = 0; k < m_visible.size(); ++k)
+        {
+            const SceneObject& object {scene.object(m_visible[k])};
+            MeshWork& w {*m_object_work[k]};
+
+            const MeshView* mesh {object.renderable.mesh};
+            w.lod_skipped = 0;
+
+            if (mesh != nullptr && mesh->lods != nullptr)
+            {
+                const Transform& t {object.renderable.transform};
+                float pixels_per_unit {pixelsPerUnit(mesh->bounds, object.model, t.scale, cam_data, m_height)};
+                size_t level {selectLOD(*mesh->lods, pixels_per_unit, m_lod_error_pixels)};
+
+                // Level 0 is the source mesh, which the object already points at
+                if (level > 0)
+                {
+                    w.lod_view = mesh->lods->levels[level].mesh;
+                    w.lod_skipped = getMeshLength(*mesh) - getMeshLength(w.lod_view);
+                    mesh = &w.lod_view;
+                }
+            }
+
+            if (mesh != nullptr)
+            {
+                w.mvp = cam_data.view_projection.MatMult(object.model);
+                m_jobs->precede(scheduleObject(*mesh, cam_data, w), merge);
+            }
+            else
+            {
+                w.mvp = cam_data.view_projection.MatMult(object.model).MatMult(placeholderMatrix(object.local_box));
+                m_jobs->precede(scheduleObject(m_placeholder, cam_data, w), merge);
+            }
+        }
+    })};
+    m_jobs->precede(cull, merge);
+
+    m_jobs->run();
+
+    m_stats.objects_culled += scene.size() - m_visible.size();
+    RAST_PROFILE_COUNT("objects.culled", scene.size() - m_visible.size());
+    m_stats.cull_ms += cull_ms;
 
-        // Render
-        SDL_RenderGeometry(m_renderer, nullptr, vertices, 3, nullptr, 0);
+    for (size_t k = 0; k < m_visible.size(); ++k)
+    {
+        const MeshWork& w {*m_object_work[k]};
+        countWork(w);
+
+        m_stats.triangles_lod_skipped += w.lod_skipped;
+        RAST_PROFILE_COUNT("triangles.lod_skipped", w.lod_skipped);
+
+        // Summed over the jobs, which overlap in time
+        m_stats.vertex_ms += (double)w.vertex_ns / 1e6;
+        m_stats.setup_ms += (double)w.setup_ns / 1e6;
+
+        // SDL draws in call order, so batches go out here on this thread
+        if (m_backend == RenderBackend::SDLGeometry)
+        {
+            submitBatch(w);
+        }
     }
-}
\ No newline at end of file
+}
+
+void Renderer::RenderInstanced(const Mesh& m, std::span<const Transform> instances)
+{
+    renderInstanced(m, instances);
+}
+
+void Renderer::RenderInstanced(const Mesh& m, std::span<const Matrix4x4> models)
+{
+    renderInstanced(m, models);
+}
+
+void Renderer::RenderInstanced(const MeshSoA& m, std::span<const Transform> instances)
+{
+    renderInstanced(m, instances);
+}
+
+void Renderer::RenderInstanced(const MeshSoA& m, std::span<const Matrix4x4> models)
+{
+    renderInstanced(m, models);
+}
+
+void Renderer::RenderInstanced(const MeshView& m, std::span<const Transform> instances)
+{
+    renderInstanced(m, instances);
+}
+
+void Renderer::RenderInstanced(const MeshView& m, std::span<const Matrix4x4> models)
+{
+    renderInstanced(m, models);
+}
@@ -0,0 +1,192 @@
+#include "../include/scene.hpp"
+
+#include <algorithm>
+
+static Vector3 centroid(const AABB& box)
+{
+    Vector3 box_min {box.min};
+    Vector3 box_max {box.max};
+    return (box_min + box_max) * 0.5f;
+}
+
+ObjectId Scene::add(const MeshView* mesh, const Transform& transform)
+{
+    ObjectId id {add(getBounds(*mesh).box, transform)};
+    m_objects[id].renderable.mesh = mesh;
+    return id;
+}
+
+ObjectId Scene::add(const AABB& placeholder, const Transform& transform)
+{
+    ObjectId id {(ObjectId)m_objects.size()};
+    Matrix4x4 model {transform.transformMatrix()};
+
+    m_objects.push_back(SceneObject{
+        RenderableView{nullptr, transform},
+        model,
+        placeholder,
+        transformAABB(placeholder, model)
+    });
+
+    // New objects change the tree shape, so build on the next cull
+    m_needs_build = true;
+    ++m_revision;
+    return id;
+}
+
+void Scene::setMesh(ObjectId id, const MeshView* mesh)
+{
+    SceneObject& object {m_objects[id]};
+    object.renderable.mesh = mesh;
+    object.local_box = getBounds(*mesh).box;
+    refit(id);
+}
+
+void Scene::setTransform(ObjectId id, const Transform& transform)
+{
+    SceneObject& object {m_objects[id]};
+    object.renderable.transform = transform;
+    object.model = transform.transformMatrix();
+    refit(id);
+}
+
+void Scene::refit(ObjectId id)
+{
+    SceneObject& object {m_objects[id]};
+    object.world_box = transformAABB(object.local_box, object.model);
+    ++m_revision;
+
+    if (m_needs_build) return;
+
+    uint32_t node {m_leaf_of[id]};
+    m_nodes[node].box = object.world_box;
+
+    for (node = m_nodes[node].parent; node != BVHNode::NONE; node = m_nodes[node].parent)
+    {
+        BVHNode& n {m_nodes[node]};
+        n.box = mergeAABB(m_nodes[n.left].box, m_nodes[n.right].box);
+    }
+}
+
+void Scene::rebuild()
+{
+    m_nodes.clear();
+    m_leaf_of.assign(m_objects.size(), BVHNode::NONE);
+    m_root = BVHNode::NONE;
+    m_needs_build = false;
+
+    if (m_objects.empty()) return;
+
+    m_nodes.reserve(m_objects.size() * 2 - 1);
+    m_build_order.resize(m_objects.size());
+    for (size_t i = 0; i < m_objects.size(); ++i)
+    {
+        m_build_order[i] = (ObjectId)i;
+    }
+
+    m_root = build(BVHNode::NONE, 0, m_objects.size());
+}
+
+uint32_t Scene::build(uint32_t parent, size_t begin, size_t end)
+{
+    uint32_t index {(uint32_t)m_nodes.size()};
+    m_nodes.push_back(BVHNode{});
+    m_nodes[index].parent = parent;
+
+    if (end - begin == 1)
+    {
+        ObjectId id {m_build_order[begin]};
+        m_nodes[index].box = m_objects[id].world_box;
+        m_nodes[index].object = id;
+        m_leaf_of[id] = index;
+        return index;
+    }
+
+    // Split at the median centroid along the widest centroid axis
+    AABB centroids {centroid(m_objects[m_build_order[begin]].world_box), centroid(m_objects[m_build_order[begin]].world_box)};
+    for (size_t i = begin + 1; i < end; ++i)
+    {
+        Vector3 c {centroid(m_objects[m_build_order[i]].world_box)};
+        centroids = mergeAABB(centroids, AABB{c, c});
+    }
+
+    Vector3 spread {centroids.max - centroids.min};
+    int axis {0};
+    if (spread.y() > spread.v[axis]) axis = 1;
+    if (spread.z() > spread.v[axis]) axis = 2;
+
+    size_t middle {begin + (end - begin) / 2};
+    std::nth_element(
+        m_build_order.begin() + begin,
+        m_build_order.begin() + middle,
+        m_build_order.begin() + end,
+        [&](ObjectId a, ObjectId b) {
+            return centroid(m_objects[a].world_box).v[axis] < centroid(m_objects[b].world_box).v[axis];
+        }
+    );
+
+    uint32_t left {build(index, begin, middle)};
+    uint32_t right {build(index, middle, end)};
+
+    BVHNode& node {m_nodes[index]};
+    node.left = left;
+    node.right = right;
+    node.box = mergeAABB(m_nodes[left].box, m_nodes[right].box);
+    return index;
+}
+
+void Scene::appendSubtree(uint32_t node, std::vector<ObjectId>& visible)
+{
+    size_t base {m_stack.size()};
+    m_stack.push_back(node);
+
+    while (m_stack.size() > base)
+    {
+        const BVHNode& n {m_nodes[m_stack.back()]};
+        m_stack.pop_back();
+
+        if (n.isLeaf())
+        {
+            visible.push_back(n.object);
+        }
+        else
+        {
+            m_stack.push_back(n.left);
+            m_stack.push_back(n.right);
+        }
+    }
+}
+
+void Scene::cull(const Frustum& frustum, std::vector<ObjectId>& visible)
+{
+    if (m_needs_build) rebuild();
+
+    m_node_tests = 0;
+    if (m_root == BVHNode::NONE) return;
+
+    m_stack.clear();
+    m_stack.push_back(m_root);
+
+    while (!m_stack.empty())
+    {
+        uint32_t index {m_stack.back()};
+        m_stack.pop_back();
+
+        const BVHNode& node {m_nodes[index]};
+        ++m_node_tests;
+
+        Containment c {classify(node.box, frustum)};
+        if (c == Containment::Outside) continue;
+
+        // Subtrees fully inside need no further plane tests
+        if (c == Containment::Inside || node.isLeaf())
+        {
+            appendSubtree(index, visible);
+        }
+        else
+        {
+            m_stack.push_back(node.left);
+            m_stack.push_back(node.right);
+        }
+    }
+}
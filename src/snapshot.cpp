@@ -0,0 +1,44 @@
+#include "../include/snapshot.hpp"
+
+static bool sameTransform(const Transform& a, const Transform& b)
+{
+    return (
+        a.pos.v == b.pos.v &&
+        a.scale.v == b.scale.v &&
+        a.rotation.w() == b.rotation.w() && a.rotation.x() == b.rotation.x() &&
+        a.rotation.y() == b.rotation.y() && a.rotation.z() == b.rotation.z()
+    );
+}
+
+void captureSnapshot(const Camera& camera, const Scene& scene, SceneSnapshot& out)
+{
+    out.camera = camera.state();
+
+    // Slots are reused, so this stops allocating once every slot has grown
+    out.transforms.clear();
+    out.meshes.clear();
+    for (ObjectId id = 0; id < scene.size(); ++id)
+    {
+        out.transforms.push_back(scene.transform(id));
+        out.meshes.push_back(scene.object(id).renderable.mesh);
+    }
+}
+
+void applySnapshot(const SceneSnapshot& snapshot, Camera& camera, Scene& scene)
+{
+    camera.setState(snapshot.camera);
+
+    for (ObjectId id = 0; id < scene.size() && id < snapshot.transforms.size(); ++id)
+    {
+        // Swapped in as a whole; the loader finished the mesh before publishing it
+        if (scene.object(id).renderable.mesh != snapshot.meshes[id])
+        {
+            scene.setMesh(id, snapshot.meshes[id]);
+        }
+
+        if (!sameTransform(scene.transform(id), snapshot.transforms[id]))
+        {
+            scene.setTransform(id, snapshot.transforms[id]);
+        }
+    }
+}
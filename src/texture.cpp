@@ -0,0 +1,134 @@
+#include "../include/texture.hpp"
+#include "../include/imageread.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+// Averages up to 2x2 texels of the finer level per channel; odd edges reuse the last texel
+static std::vector<uint32_t> downsample(const std::vector<uint32_t>& src, int width, int height, int out_width, int out_height)
+{
+    std::vector<uint32_t> out((size_t)out_width * out_height);
+
+    for (int y = 0; y < out_height; ++y)
+    {
+        int y0 {std::min(y * 2, height - 1)};
+        int y1 {std::min(y * 2 + 1, height - 1)};
+
+        for (int x = 0; x < out_width; ++x)
+        {
+            int x0 {std::min(x * 2, width - 1)};
+            int x1 {std::min(x * 2 + 1, width - 1)};
+
+            uint32_t t[4] {
+                src[(size_t)y0 * width + x0], src[(size_t)y0 * width + x1],
+                src[(size_t)y1 * width + x0], src[(size_t)y1 * width + x1]
+            };
+
+            uint32_t result {0};
+            for (int shift = 0; shift < 32; shift += 8)
+            {
+                uint32_t sum {2};
+                for (uint32_t texel : t) sum += (texel >> shift) & 0xFF;
+                result |= (sum / 4) << shift;
+            }
+            out[(size_t)y * out_width + x] = result;
+        }
+    }
+
+    return out;
+}
+
+Texture::Texture(int width, int height, std::span<const uint32_t> texels)
+{
+    // Level sizes and where each starts; tiles are padded to full 8x8
+    size_t total {0};
+    for (int w = width, h = height; ; w = std::max(w / 2, 1), h = std::max(h / 2, 1))
+    {
+        int tiles_x {(w + RAST::TEXTURE_TILE - 1) / RAST::TEXTURE_TILE};
+        int tiles_y {(h + RAST::TEXTURE_TILE - 1) / RAST::TEXTURE_TILE};
+
+        m_levels.push_back(Level{w, h, tiles_x, total});
+        total += (size_t)tiles_x * tiles_y * RAST::TEXTURE_TILE * RAST::TEXTURE_TILE;
+
+        if (w == 1 && h == 1) break;
+    }
+
+    m_texels.resize(total);
+
+    std::vector<uint32_t> linear(texels.begin(), texels.end());
+    for (int level = 0; level < levels(); ++level)
+    {
+        const Level& l {m_levels[level]};
+        if (level > 0)
+        {
+            const Level& finer {m_levels[level - 1]};
+            linear = downsample(linear, finer.width, finer.height, l.width, l.height);
+        }
+
+        for (int y = 0; y < l.height; ++y)
+        {
+            for (int x = 0; x < l.width; ++x)
+            {
+                m_texels[l.offset + tiledIndex(x, y, l.tiles_x)] = linear[(size_t)y * l.width + x];
+            }
+        }
+    }
+}
+
+int Texture::selectLevel(float rho2) const
+{
+    if (!(rho2 > 1.0f)) return 0;
+
+    // log2(rho) rounded to the nearest level
+    int level {(std::ilogb(rho2) + 1) / 2};
+    return std::min(level, levels() - 1);
+}
+
+static inline int wrap(int i, int size)
+{
+    i %= size;
+    return i < 0 ? i + size : i;
+}
+
+ColorRGB Texture::sample(float u, float v, int level) const
+{
+    const Level& l {m_levels[level]};
+
+    // Texel centres sit at half-integer coordinates
+    float fx {u * l.width - 0.5f};
+    float fy {v * l.height - 0.5f};
+    float floor_x {std::floor(fx)};
+    float floor_y {std::floor(fy)};
+    float tx {fx - floor_x};
+    float ty {fy - floor_y};
+
+    // Far outside [0, 1) the int conversion would overflow; the pattern repeats anyway
+    int x0 {wrap((int)std::fmod(floor_x, (float)l.width), l.width)};
+    int y0 {wrap((int)std::fmod(floor_y, (float)l.height), l.height)};
+    int x1 {x0 + 1 == l.width ? 0 : x0 + 1};
+    int y1 {y0 + 1 == l.height ? 0 : y0 + 1};
+
+    uint32_t t00 {m_texels[l.offset + tiledIndex(x0, y0, l.tiles_x)]};
+    uint32_t t10 {m_texels[l.offset + tiledIndex(x1, y0, l.tiles_x)]};
+    uint32_t t01 {m_texels[l.offset + tiledIndex(x0, y1, l.tiles_x)]};
+    uint32_t t11 {m_texels[l.offset + tiledIndex(x1, y1, l.tiles_x)]};
+
+    auto channel = [&](int shift) {
+        float c00 {(float)((t00 >> shift) & 0xFF)};
+        float c10 {(float)((t10 >> shift) & 0xFF)};
+        float c01 {(float)((t01 >> shift) & 0xFF)};
+        float c11 {(float)((t11 >> shift) & 0xFF)};
+
+        float top {c00 + (c10 - c00) * tx};
+        float bottom {c01 + (c11 - c01) * tx};
+        return (top + (bottom - top) * ty) * (1.0f / 255.0f);
+    };
+
+    return ColorRGB(channel(16), channel(8), channel(0));
+}
+
+Texture loadTexture(const std::string& filename)
+{
+    Image image {readImage(filename)};
+    return Texture(image.width, image.height, image.pixels);
+}
@@ -0,0 +1,96 @@
+#include "../include/threadpool.hpp"
+
+ThreadPool::ThreadPool(unsigned thread_count)
+{
+    if (thread_count == 0)
+    {
+        unsigned hardware {std::thread::hardware_concurrency()};
+        thread_count = hardware > 1 ? hardware - 1 : 0;
+    }
+
+    m_workers.reserve(thread_count);
+    for (unsigned i = 0; i < thread_count; ++i)
+    {
+        m_workers.emplace_back(&ThreadPool::workerLoop, this);
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_wake.notify_all();
+
+    for (auto& worker : m_workers)
+    {
+        worker.join();
+    }
+}
+
+void ThreadPool::run(size_t count, Task task, void* context)
+{
+    if (count == 0) return;
+
+    if (m_workers.empty() || count == 1)
+    {
+        for (size_t i = 0; i < count; ++i)
+        {
+            task(context, i);
+        }
+        return;
+    }
+
+    std::lock_guard<std::mutex> run_lock(m_run_mutex);
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_task = task;
+        m_context = context;
+        m_count = count;
+        m_next.store(0, std::memory_order_relaxed);
+        m_busy = m_workers.size();
+        ++m_generation;
+    }
+    m_wake.notify_all();
+
+    drain();
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_done.wait(lock, [this] {return m_busy == 0;});
+    m_task = nullptr;
+}
+
+void ThreadPool::drain()
+{
+    // Indices are handed out one at a time so uneven items balance out
+    size_t i;
+    while ((i = m_next.fetch_add(1, std::memory_order_relaxed)) < m_count)
+    {
+        m_task(m_context, i);
+    }
+}
+
+void ThreadPool::workerLoop()
+{
+    uint64_t seen {0};
+
+    while (true)
+    {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_wake.wait(lock, [&] {return m_stop || m_generation != seen;});
+            if (m_stop) return;
+            seen = m_generation;
+        }
+
+        drain();
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (--m_busy == 0)
+        {
+            m_done.notify_one();
+        }
+    }
+}